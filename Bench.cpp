@@ -0,0 +1,256 @@
+// Bench.cpp
+//
+// This file is a part of RCKangaroo software
+// (c) 2024, RetiredCoder (RC)
+// License: GPLv3, see "LICENSE.TXT" file
+// https://github.com/RetiredC
+
+
+#include <stdlib.h>
+#include "Bench.h"
+#include "utils.h"
+#include "Net.h"
+
+//about 10ms of DPs from a fast rig at low DP
+#define BENCH_BATCH_CNT		(16 * 1024)
+//stored records kept for hit lookups
+#define BENCH_SAMPLE_CNT	(1024 * 1024)
+#define BENCH_LOOKUP_CNT	(4 * 1024 * 1024)
+
+//DP records are random, so we can use simple xorshift instead of EcInt rnd
+static u64 bench_rnd;
+
+static u64 BenchRnd()
+{
+	bench_rnd ^= bench_rnd << 13;
+	bench_rnd ^= bench_rnd >> 7;
+	bench_rnd ^= bench_rnd << 17;
+	return bench_rnd;
+}
+
+static void BenchFillBatch(u8* buf, int cnt)
+{
+	for (int i = 0; i < cnt; i++)
+	{
+		u64 tmp[5];
+		for (int j = 0; j < 5; j++)
+			tmp[j] = BenchRnd();
+		u8* rec = buf + i * DB_FULL_REC_LEN;
+		memcpy(rec, tmp, DB_FULL_REC_LEN - 1);
+		rec[DB_FULL_REC_LEN - 1] = i % 3; //kang type
+	}
+}
+
+//returns time in ms, samples (if not NULL) receives up to BENCH_SAMPLE_CNT inserted records
+static u64 BenchIngestPass(TFastBase* db, u8* buf, u64 rec_cnt, bool batch, u8* samples, int* sample_cnt)
+{
+	bench_rnd = 0x9E3779B97F4A7C15ull; //same records for both passes
+	u64 tm = GetTickCount64();
+	u64 done = 0;
+	while (done < rec_cnt)
+	{
+		int cnt = (int)((rec_cnt - done < BENCH_BATCH_CNT) ? (rec_cnt - done) : BENCH_BATCH_CNT);
+		BenchFillBatch(buf, cnt);
+		if (samples && (*sample_cnt < BENCH_SAMPLE_CNT))
+		{
+			int step = (int)(rec_cnt / BENCH_SAMPLE_CNT + 1);
+			for (int i = 0; (i < cnt) && (*sample_cnt < BENCH_SAMPLE_CNT); i += step)
+				memcpy(samples + (u64)(*sample_cnt)++ * DB_FULL_REC_LEN, buf + i * DB_FULL_REC_LEN, DB_FULL_REC_LEN);
+		}
+		if (batch)
+			db->FindOrAddBatch(buf, cnt, NULL, NULL);
+		else
+			for (int i = 0; i < cnt; i++)
+				db->FindOrAddDataBlock(buf + i * DB_FULL_REC_LEN);
+		done += cnt;
+	}
+	tm = GetTickCount64() - tm;
+	return tm ? tm : 1;
+}
+
+//dependent lookups: next key is derived from the previous result, so lookups cannot overlap and we measure latency, not throughput
+//returns ns per lookup
+static double BenchLookupLatency(TFastBase* db, u8* samples, int sample_cnt, bool hit, u64* found_cnt)
+{
+	u8 rec[DB_FULL_REC_LEN];
+	u64 ind = 0x2545F4914F6CDD1Dull;
+	*found_cnt = 0;
+	u64 tm = GetTickCount64();
+	for (int i = 0; i < BENCH_LOOKUP_CNT; i++)
+	{
+		u8* key;
+		if (hit)
+			key = samples + ((ind >> 33) % sample_cnt) * DB_FULL_REC_LEN;
+		else
+		{
+			u64 tmp[2];
+			tmp[0] = ind;
+			tmp[1] = ind * 0x9E3779B97F4A7C15ull;
+			memcpy(rec, tmp, 16);
+			key = rec;
+		}
+		u8* res = db->FindDataBlock(key);
+		if (res)
+			(*found_cnt)++;
+		ind = ind * 6364136223846793005ull + 1442695040888963407ull + (u64)(size_t)res;
+	}
+	tm = GetTickCount64() - tm;
+	return tm * 1000000.0 / BENCH_LOOKUP_CNT;
+}
+
+//compares one-by-one inserts (old CheckNewPoints) with FindOrAddBatch, then measures lookup latency
+void BenchDb(u64 rec_cnt, int huge_mode, int numa_mode)
+{
+	printf("DB benchmark: %llu records, batch size %d\r\n", rec_cnt, BENCH_BATCH_CNT);
+	TFastBase* db = new TFastBase();
+	if (!db->SetAllocMode(huge_mode, numa_mode))
+	{
+		delete db;
+		return;
+	}
+	u8* buf = (u8*)malloc(BENCH_BATCH_CNT * DB_FULL_REC_LEN);
+	u8* samples = (u8*)malloc(BENCH_SAMPLE_CNT * DB_FULL_REC_LEN);
+	int sample_cnt = 0;
+	db->Clear();
+	u64 tm1 = BenchIngestPass(db, buf, rec_cnt, false, NULL, NULL);
+	printf("Single inserts: %.3f sec, %.3f M records/sec\r\n", tm1 / 1000.0, (rec_cnt / 1000.0) / tm1);
+	db->Clear();
+	u64 tm2 = BenchIngestPass(db, buf, rec_cnt, true, samples, &sample_cnt);
+	printf("Batch inserts: %.3f sec, %.3f M records/sec\r\n", tm2 / 1000.0, (rec_cnt / 1000.0) / tm2);
+	printf("Speedup: %.2fx\r\n", (double)tm1 / tm2);
+	TDbStats dbs;
+	db->GetStats(&dbs);
+	printf("DB: %llu records, %llu pages, %.3f GB total, %.2f bytes per record\r\n", dbs.RecCnt, dbs.PageCnt,
+		(double)dbs.TotalBytes / (1024 * 1024 * 1024), (double)(dbs.PoolBytes + dbs.ListBytes) / dbs.RecCnt);
+	printf("List depth histogram:");
+	for (int i = 0; i < DB_DEPTH_HIST_CNT; i++)
+		if (dbs.DepthHist[i])
+			printf(" %u:%llu", i ? (1u << (i - 1)) : 0, dbs.DepthHist[i]);
+	printf("\r\n");
+	u64 found;
+	if (sample_cnt)
+	{
+		double ns = BenchLookupLatency(db, samples, sample_cnt, true, &found);
+		printf("Lookup latency (stored keys): %.1f ns, found %llu of %d\r\n", ns, found, BENCH_LOOKUP_CNT);
+	}
+	double ns = BenchLookupLatency(db, samples, sample_cnt, false, &found);
+	printf("Lookup latency (missing keys): %.1f ns, found %llu of %d\r\n", ns, found, BENCH_LOOKUP_CNT);
+	//Reset keeps pages and list arrays, so refill doesn't allocate anything
+	u64 tm = GetTickCount64();
+	db->Reset();
+	u64 tm_reset = GetTickCount64() - tm;
+	u64 tm3 = BenchIngestPass(db, buf, rec_cnt, true, NULL, NULL);
+	printf("Reset: %llu ms, batch inserts after reset: %.3f sec, %.3f M records/sec\r\n", tm_reset, tm3 / 1000.0, (rec_cnt / 1000.0) / tm3);
+	tm = GetTickCount64();
+	db->Clear();
+	printf("Clear: %llu ms\r\n", GetTickCount64() - tm);
+	free(samples);
+	free(buf);
+	delete db;
+}
+
+//fills empty DB with random records and returns memory per record, DB is reset after measurement (pages and list arrays stay reserved)
+//fixed_bytes receives memory that doesn't depend on the number of records
+double MeasureDbRecCost(TFastBase* db, u64 rec_cnt, u64* fixed_bytes)
+{
+	u8* buf = (u8*)malloc(BENCH_BATCH_CNT * DB_FULL_REC_LEN);
+	db->Reset();
+	BenchIngestPass(db, buf, rec_cnt, true, NULL, NULL);
+	free(buf);
+	TDbStats dbs;
+	db->GetStats(&dbs);
+	db->Reset();
+	*fixed_bytes = dbs.IndexBytes;
+	return dbs.RecCnt ? (double)(dbs.PoolBytes + dbs.ListBytes) / dbs.RecCnt : 0.0;
+}
+
+//DP records like GPUs send them: random X, distance of "range" bits (negative for some wilds), kang type
+static void BenchFillWireBatch(u8* buf, int cnt, int range)
+{
+	for (int i = 0; i < cnt; i++)
+	{
+		u8* rec = buf + i * DB_FULL_REC_LEN;
+		u64 x[2];
+		x[0] = BenchRnd();
+		x[1] = BenchRnd();
+		memcpy(rec, x, 12);
+		u64 d[3];
+		d[0] = BenchRnd();
+		d[1] = (range > 64) ? BenchRnd() : 0;
+		d[2] = (range > 128) ? BenchRnd() : 0;
+		if (range % 64)
+			d[range / 64] &= (1ull << (range % 64)) - 1;
+		int type = i % 3;
+		if ((type != TAME) && (BenchRnd() & 1))
+		{
+			d[0] = ~d[0];
+			d[1] = ~d[1];
+			d[2] = ~d[2];
+		}
+		memcpy(rec + 12, d, 22);
+		rec[DB_FULL_REC_LEN - 1] = type;
+	}
+}
+
+static int cmp_rec(const void* a, const void* b)
+{
+	return memcmp(a, b, DB_FULL_REC_LEN);
+}
+
+//pass 0 - encode, 1 - encode and decode, 2 - check that decoded batches match source. Returns time in ms
+static u64 BenchWirePass(int pass, u64 rec_cnt, int range, u8* buf, u8* packed, u8* decoded, u64* packed_size, bool* ok)
+{
+	bench_rnd = 0x9E3779B97F4A7C15ull;
+	*packed_size = 0;
+	*ok = true;
+	u64 tm = GetTickCount64();
+	for (u64 done = 0; done < rec_cnt; done += BENCH_BATCH_CNT)
+	{
+		int cnt = (int)((rec_cnt - done < BENCH_BATCH_CNT) ? (rec_cnt - done) : BENCH_BATCH_CNT);
+		BenchFillWireBatch(buf, cnt, range);
+		int len = NetEncodeDPs(buf, cnt, packed);
+		*packed_size += len;
+		if (!pass)
+			continue;
+		int dcnt = NetDecodeDPs(packed, len, decoded, cnt);
+		if (pass == 1)
+			continue;
+		qsort(buf, cnt, DB_FULL_REC_LEN, cmp_rec);
+		qsort(decoded, cnt, DB_FULL_REC_LEN, cmp_rec);
+		if ((dcnt != cnt) || memcmp(buf, decoded, (u64)cnt * DB_FULL_REC_LEN))
+			*ok = false;
+	}
+	tm = GetTickCount64() - tm;
+	return tm ? tm : 1;
+}
+
+//measures size and speed of packed DP batches (NetEncodeDPs/NetDecodeDPs) for given range
+void BenchWire(u64 rec_cnt, int range)
+{
+	printf("Wire format benchmark: %llu records, range %d bits, batch size %d\r\n", rec_cnt, range, BENCH_BATCH_CNT);
+	u8* buf = (u8*)malloc(BENCH_BATCH_CNT * DB_FULL_REC_LEN);
+	u8* packed = (u8*)malloc(NET_PACKED_MAX_LEN(BENCH_BATCH_CNT));
+	u8* decoded = (u8*)malloc(BENCH_BATCH_CNT * DB_FULL_REC_LEN);
+	u64 packed_size;
+	bool ok;
+	//time of record generation is not included
+	bench_rnd = 0x9E3779B97F4A7C15ull;
+	u64 tm = GetTickCount64();
+	for (u64 done = 0; done < rec_cnt; done += BENCH_BATCH_CNT)
+		BenchFillWireBatch(buf, BENCH_BATCH_CNT, range);
+	u64 tm_fill = GetTickCount64() - tm;
+	u64 tm_enc = BenchWirePass(0, rec_cnt, range, buf, packed, decoded, &packed_size, &ok);
+	u64 tm_all = BenchWirePass(1, rec_cnt, range, buf, packed, decoded, &packed_size, &ok);
+	u64 tm_dec = (tm_all > tm_enc) ? tm_all - tm_enc : 1;
+	tm_enc = (tm_enc > tm_fill) ? tm_enc - tm_fill : 1;
+	BenchWirePass(2, rec_cnt, range, buf, packed, decoded, &packed_size, &ok);
+	double rec_len = (double)packed_size / rec_cnt;
+	printf("GPU record: %d bytes, DB record: %d bytes, packed: %.2f bytes per record (%.2fx less than DB records)\r\n",
+		GPU_DP_SIZE, DB_FULL_REC_LEN, rec_len, DB_FULL_REC_LEN / rec_len);
+	printf("Encode: %.3f M records/sec, decode: %.3f M records/sec\r\n", (rec_cnt / 1000.0) / tm_enc, (rec_cnt / 1000.0) / tm_dec);
+	printf("Traffic for 1M DPs/sec: %.1f Mbit/s packed, %.1f Mbit/s DB records\r\n", rec_len * 8, DB_FULL_REC_LEN * 8.0);
+	printf("Round trip check: %s\r\n", ok ? "OK" : "FAILED");
+	free(decoded);
+	free(packed);
+	free(buf);
+}
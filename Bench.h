@@ -0,0 +1,17 @@
+// Bench.h
+//
+// This file is a part of RCKangaroo software
+// (c) 2024, RetiredCoder (RC)
+// License: GPLv3, see "LICENSE.TXT" file
+// https://github.com/RetiredC
+
+
+#pragma once
+
+#include "defs.h"
+
+class TFastBase;
+
+void BenchDb(u64 rec_cnt, int huge_mode, int numa_mode);
+double MeasureDbRecCost(TFastBase* db, u64 rec_cnt, u64* fixed_bytes);
+void BenchWire(u64 rec_cnt, int range);
@@ -26,21 +26,16 @@ int RCGpuKang::CalcKangCnt()
 	return Kparams.BlockSize * Kparams.GroupCnt * Kparams.BlockCnt;
 }
 
-//executes in main thread
-bool RCGpuKang::Prepare(EcPoint _PntToSolve, int _Range, int _DP, EcJMP* _EcJumps1, EcJMP* _EcJumps2, EcJMP* _EcJumps3)
+//executes in main thread, once per session: allocates memory and uploads jumps, they don't depend on the point to solve
+bool RCGpuKang::Prepare(int _Range, int _DP, EcJMP* _EcJumps1, EcJMP* _EcJumps2, EcJMP* _EcJumps3)
 {
-	PntToSolve = _PntToSolve;
 	Range = _Range;
 	DP = _DP;
 	EcJumps1 = _EcJumps1;
 	EcJumps2 = _EcJumps2;
 	EcJumps3 = _EcJumps3;
-	StopFlag = false;
 	Failed = false;
 	u64 total_mem = 0;
-	memset(dbg, 0, sizeof(dbg));
-	memset(SpeedStats, 0, sizeof(SpeedStats));
-	cur_stats_ind = 0;
 
 	cudaError_t err;
 	err = cudaSetDevice(CudaIndex);
@@ -53,6 +48,10 @@ bool RCGpuKang::Prepare(EcPoint _PntToSolve, int _Range, int _DP, EcJMP* _EcJump
 	KangCnt = Kparams.BlockSize * Kparams.GroupCnt * Kparams.BlockCnt;
 	Kparams.KangCnt = KangCnt;
 	Kparams.DP = DP;
+	Kparams.DPExtMask = 0;
+	ResumeKangs = NULL;
+	TargetCnt = 0;
+	KeepKangs = false;
 	Kparams.KernelA_LDS_Size = 64 * JMP_CNT + 16 * Kparams.BlockSize;
 	Kparams.KernelB_LDS_Size = 64 * JMP_CNT;
 	Kparams.KernelC_LDS_Size = 96 * JMP_CNT;
@@ -194,6 +193,7 @@ bool RCGpuKang::Prepare(EcPoint _PntToSolve, int _Range, int _DP, EcJMP* _EcJump
 	}
 
 	DPs_out = (u32*)malloc(MAX_DP_CNT * GPU_DP_SIZE);
+	RndPnts = (TPointPriv*)malloc(KangCnt * 96);
 
 	//jmp1
 	u64* buf = (u64*)malloc(JMP_CNT * 96);
@@ -257,8 +257,47 @@ bool RCGpuKang::Prepare(EcPoint _PntToSolve, int _Range, int _DP, EcJMP* _EcJump
 	return true;
 }
 
+//executes in main thread before every Execute, wild kangaroos are created from these points in Start
+//keep_kangs: kangs on GPU are from previous run for the same points, tames and wilds of slots with the same target continue their walks
+void RCGpuKang::SetTargets(EcPoint* _Targets, u8* _TargetIds, int _TargetCnt, bool keep_kangs)
+{
+	KeepKangs = keep_kangs && (_TargetCnt == TargetCnt);
+	TargetCnt = _TargetCnt;
+	for (int i = 0; i < TargetCnt; i++)
+	{
+		KeepWilds[i] = KeepKangs && (TargetIds[i] == _TargetIds[i]);
+		Targets[i] = _Targets[i];
+		TargetIds[i] = _TargetIds[i];
+	}
+	StopFlag = false;
+	PauseFlag = false;
+	Paused = false;
+	Active = true;
+	memset(dbg, 0, sizeof(dbg));
+	memset(SpeedStats, 0, sizeof(SpeedStats));
+	cur_stats_ind = 0;
+}
+
+//kangs (KangCnt * 96 bytes: x, y, distance) are used instead of random kangs by next Start, buffer is copied
+void RCGpuKang::SetResumeKangs(u8* kangs)
+{
+	free(ResumeKangs);
+	ResumeKangs = (u8*)malloc(KangCnt * 96);
+	memcpy(ResumeKangs, kangs, KangCnt * 96);
+}
+
+//returns false if Execute is not running so kangs were not copied
+bool RCGpuKang::WaitPaused()
+{
+	while (Active && !Paused)
+		Sleep(1);
+	return Paused;
+}
+
 void RCGpuKang::Release()
 {
+	free(ResumeKangs);
+	ResumeKangs = NULL;
 	free(RndPnts);
 	free(DPs_out);
 	cudaFree(Kparams.LoopedKangs);
@@ -275,6 +314,22 @@ void RCGpuKang::Release()
 	cudaFree(Kparams.DPs_out);
 	if (!IsOldGpu)
 		cudaFree(Kparams.L2);
+	//safe to call again, also after failed Prepare
+	RndPnts = NULL;
+	DPs_out = NULL;
+	Kparams.LoopedKangs = NULL;
+	Kparams.dbg_buf = NULL;
+	Kparams.LoopTable = NULL;
+	Kparams.LastPnts = NULL;
+	Kparams.L1S2 = NULL;
+	Kparams.DPTable = NULL;
+	Kparams.JumpsList = NULL;
+	Kparams.Jumps3 = NULL;
+	Kparams.Jumps2 = NULL;
+	Kparams.Jumps1 = NULL;
+	Kparams.Kangs = NULL;
+	Kparams.DPs_out = NULL;
+	Kparams.L2 = NULL;
 }
 
 void RCGpuKang::Stop()
@@ -282,12 +337,66 @@ void RCGpuKang::Stop()
 	StopFlag = true;
 }
 
+//splitmix64 finalizer, used as counter-based generator for node kangs
+static u64 MixU64(u64 x)
+{
+	x ^= x >> 30;
+	x *= 0xBF58476D1CE4E5B9ull;
+	x ^= x >> 27;
+	x *= 0x94D049BB133111EBull;
+	x ^= x >> 31;
+	return x;
+}
+
+//node_cnt 0 - rnd kangs (default)
+void RCGpuKang::SetNode(int node_id, int node_cnt, u64 epoch, int gpu_ind)
+{
+	NodeId = node_id;
+	NodeCnt = node_cnt;
+	NodeEpoch = epoch;
+	NodeGpu = gpu_ind;
+	HerdCnt = 0;
+}
+
 void RCGpuKang::GenerateRndDistances()
 {
+	if (NodeCnt)
+	{
+		//distance of every kang depends on its index only, so a node can repeat its herd or continue with the next epoch.
+		//distance is q * NodeCnt + NodeId, so herds of different nodes never share start points
+		int cnt_bits = 0;
+		while ((1ull << cnt_bits) < (u64)NodeCnt)
+			cnt_bits++;
+		u64 key = MixU64(0x524B4E4F44450000ull ^ NodeEpoch);
+		key = MixU64(key ^ ((u64)NodeId << 32) ^ (u64)NodeCnt);
+		key = MixU64(key ^ ((u64)NodeGpu << 32) ^ HerdCnt);
+		HerdCnt++;
+		for (int i = 0; i < KangCnt; i++)
+		{
+			bool tame = GetKangSlot(i) / TargetCnt == TAME;
+			int nbits = (tame ? Range - 4 : Range - 2) - cnt_bits; //wild distance is doubled below to make it even
+			EcInt q, d;
+			q.SetZero();
+			for (int j = 0; j < 3; j++)
+				q.data[j] = MixU64(key + (3 * (u64)i + j + 1) * 0x9E3779B97F4A7C15ull);
+			int k = nbits / 64;
+			if (nbits % 64)
+				q.data[k++] &= (1ull << (nbits % 64)) - 1;
+			for (; k < 3; k++)
+				q.data[k] = 0;
+			d.Mul_u64(q, NodeCnt);
+			q.Set(NodeId);
+			d.Add(q);
+			if (!tame)
+				d.ShiftLeft(1);
+			memcpy(RndPnts[i].priv, d.data, 24);
+		}
+		return;
+	}
 	for (int i = 0; i < KangCnt; i++)
 	{
 		EcInt d;
-		if (i < KangCnt / 3)
+		if (GetKangSlot(i) / TargetCnt == TAME)
 			d.RndBits(Range - 4); //TAME kangs
 		else
 		{
@@ -314,37 +423,93 @@ bool RCGpuKang::Start()
 	NegPntHalfRange = PntHalfRange;
 	NegPntHalfRange.y.NegModP();
 
-	PntA = ec.AddPoints(PntToSolve, NegPntHalfRange);
-	PntB = PntA;
-	PntB.y.NegModP();
+	for (int i = 0; i < TargetCnt; i++)
+	{
+		PntA[i] = ec.AddPoints(Targets[i], NegPntHalfRange);
+		PntB[i] = PntA[i];
+		PntB[i].y.NegModP();
+	}
 
-	RndPnts = (TPointPriv*)malloc(KangCnt * 96);
-	GenerateRndDistances();
-	/*
-		//we can calc start points on CPU
-		for (int i = 0; i < KangCnt; i++)
+	if (ResumeKangs)
+	{
+		KeepKangs = false;
+		//continue kangs from checkpoint
+		err = cudaMemcpy(Kparams.Kangs, ResumeKangs, KangCnt * 96, cudaMemcpyHostToDevice);
+		free(ResumeKangs);
+		ResumeKangs = NULL;
+		if (err != cudaSuccess)
+		{
+			printf("GPU %d, cudaMemcpy failed: %s\n", CudaIndex, cudaGetErrorString(err));
+			return false;
+		}
+	}
+	else
+	{
+		u8* kept = NULL;
+		if (KeepKangs)
 		{
-			EcInt d;
-			memcpy(d.data, RndPnts[i].priv, 24);
-			d.data[3] = 0;
-			d.data[4] = 0;
-			EcPoint p = ec.MultiplyG(d);
-			memcpy(RndPnts[i].x, p.x.data, 32);
-			memcpy(RndPnts[i].y, p.y.data, 32);
+			kept = (u8*)malloc((size_t)KangCnt * 96);
+			err = cudaMemcpy(kept, Kparams.Kangs, (size_t)KangCnt * 96, cudaMemcpyDeviceToHost);
+			if (err != cudaSuccess)
+			{
+				printf("GPU %d, cudaMemcpy failed: %s\r\n", CudaIndex, cudaGetErrorString(err));
+				free(kept);
+				return false;
+			}
 		}
-		for (int i = KangCnt / 3; i < 2 * KangCnt / 3; i++)
+		GenerateRndDistances();
+		/*
+			//we can calc start points on CPU
+			for (int i = 0; i < KangCnt; i++)
+			{
+				EcInt d;
+				memcpy(d.data, RndPnts[i].priv, 24);
+				d.data[3] = 0;
+				d.data[4] = 0;
+				EcPoint p = ec.MultiplyG(d);
+				memcpy(RndPnts[i].x, p.x.data, 32);
+				memcpy(RndPnts[i].y, p.y.data, 32);
+			}
+			for (int i = KangCnt / 3; i < 2 * KangCnt / 3; i++)
+			{
+				EcPoint p;
+				p.LoadFromBuffer64((u8*)RndPnts[i].x);
+				p = ec.AddPoints(p, PntA);
+				p.SaveToBuffer64((u8*)RndPnts[i].x);
+			}
+			for (int i = 2 * KangCnt / 3; i < KangCnt; i++)
+			{
+				EcPoint p;
+				p.LoadFromBuffer64((u8*)RndPnts[i].x);
+				p = ec.AddPoints(p, PntB);
+				p.SaveToBuffer64((u8*)RndPnts[i].x);
+			}
+			//copy to gpu
+			err = cudaMemcpy(Kparams.Kangs, RndPnts, KangCnt * 96, cudaMemcpyHostToDevice);
+			if (err != cudaSuccess)
+			{
+				printf("GPU %d, cudaMemcpy failed: %s\n", CudaIndex, cudaGetErrorString(err));
+				return false;
+			}
+		/**/
+		//but it's faster to calc then on GPU
+		u8 buf_PntA[MAX_TARGET_CNT][64], buf_PntB[MAX_TARGET_CNT][64];
+		for (int i = 0; i < TargetCnt; i++)
 		{
-			EcPoint p;
-			p.LoadFromBuffer64((u8*)RndPnts[i].x);
-			p = ec.AddPoints(p, PntA);
-			p.SaveToBuffer64((u8*)RndPnts[i].x);
+			PntA[i].SaveToBuffer64(buf_PntA[i]);
+			PntB[i].SaveToBuffer64(buf_PntB[i]);
 		}
-		for (int i = 2 * KangCnt / 3; i < KangCnt; i++)
+		for (int i = 0; i < KangCnt; i++)
 		{
-			EcPoint p;
-			p.LoadFromBuffer64((u8*)RndPnts[i].x);
-			p = ec.AddPoints(p, PntB);
-			p.SaveToBuffer64((u8*)RndPnts[i].x);
+			int slot = GetKangSlot(i);
+			int type = slot / TargetCnt;
+			if (type == TAME)
+				memset(RndPnts[i].x, 0, 64);
+			else
+				if (type == WILD1)
+					memcpy(RndPnts[i].x, buf_PntA[slot % TargetCnt], 64);
+				else
+					memcpy(RndPnts[i].x, buf_PntB[slot % TargetCnt], 64);
 		}
 		//copy to gpu
 		err = cudaMemcpy(Kparams.Kangs, RndPnts, KangCnt * 96, cudaMemcpyHostToDevice);
@@ -353,29 +518,33 @@ bool RCGpuKang::Start()
 			printf("GPU %d, cudaMemcpy failed: %s\n", CudaIndex, cudaGetErrorString(err));
 			return false;
 		}
-	/**/
-	//but it's faster to calc then on GPU
-	u8 buf_PntA[64], buf_PntB[64];
-	PntA.SaveToBuffer64(buf_PntA);
-	PntB.SaveToBuffer64(buf_PntB);
-	for (int i = 0; i < KangCnt; i++)
-	{
-		if (i < KangCnt / 3)
-			memset(RndPnts[i].x, 0, 64);
-		else
-			if (i < 2 * KangCnt / 3)
-				memcpy(RndPnts[i].x, buf_PntA, 64);
-			else
-				memcpy(RndPnts[i].x, buf_PntB, 64);
-	}
-	//copy to gpu
-	err = cudaMemcpy(Kparams.Kangs, RndPnts, KangCnt * 96, cudaMemcpyHostToDevice);
-	if (err != cudaSuccess)
-	{
-		printf("GPU %d, cudaMemcpy failed: %s\n", CudaIndex, cudaGetErrorString(err));
-		return false;
+		CallGpuKernelGen(Kparams);
+		if (kept)
+		{
+			//put back kangs of kept slots, every slot is a contiguous range of kangs
+			int i = 0;
+			while (i < KangCnt)
+			{
+				int slot = GetKangSlot(i);
+				int k = i + 1;
+				while ((k < KangCnt) && (GetKangSlot(k) == slot))
+					k++;
+				if ((slot / TargetCnt == TAME) || KeepWilds[slot % TargetCnt])
+				{
+					err = cudaMemcpy(Kparams.Kangs + (size_t)i * 12, kept + (size_t)i * 96, (size_t)(k - i) * 96, cudaMemcpyHostToDevice);
+					if (err != cudaSuccess)
+					{
+						printf("GPU %d, cudaMemcpy failed: %s\r\n", CudaIndex, cudaGetErrorString(err));
+						free(kept);
+						return false;
+					}
+				}
+				i = k;
+			}
+			free(kept);
+		}
+		KeepKangs = false;
 	}
-	CallGpuKernelGen(Kparams);
 
 	err = cudaMemset(Kparams.L1S2, 0, mpCnt * Kparams.BlockSize * 8);
 	if (err != cudaSuccess)
@@ -409,13 +578,14 @@ int RCGpuKang::Dbg_CheckKangs()
 		p = ec.MultiplyG_Fast(dist);
 		if (neg)
 			p.y.NegModP();
-		if (i < KangCnt / 3)
+		int slot = GetKangSlot(i);
+		if (slot / TargetCnt == TAME)
 			p = p;
 		else
-			if (i < 2 * KangCnt / 3)
-				p = ec.AddPoints(PntA, p);
+			if (slot / TargetCnt == WILD1)
+				p = ec.AddPoints(PntA[slot % TargetCnt], p);
 			else
-				p = ec.AddPoints(PntB, p);
+				p = ec.AddPoints(PntB[slot % TargetCnt], p);
 		if (!p.IsEqual(Pnt))
 			res++;
 	}
@@ -434,6 +604,7 @@ void RCGpuKang::Execute()
 	if (!Start())
 	{
 		gTotalErrors++;
+		Active = false;
 		return;
 	}
 #ifdef DEBUG_MODE
@@ -471,6 +642,14 @@ void RCGpuKang::Execute()
 				gTotalErrors++;
 				break;
 			}
+			//GPU stores kang index in DP, add target index to kang type
+			if (TargetCnt > 1)
+				for (int i = 0; i < cnt; i++)
+				{
+					u32* dp = DPs_out + i * GPU_DP_SIZE / 4;
+					if ((*(u8*)(dp + 10) & KANG_TYPE_MASK) != TAME) //tames are shared by all targets
+						*(u8*)(dp + 10) |= TargetIds[GetKangSlot(dp[11]) % TargetCnt] << TARGET_SHIFT;
+				}
 			AddPointsToList(DPs_out, cnt, (u64)KangCnt * STEP_CNT);
 		}
 
@@ -505,9 +684,23 @@ void RCGpuKang::Execute()
 		}
 		iter++;
 #endif
+		if (PauseFlag)
+		{
+			//checkpoint: DPs of this iteration are already in the list, so kangs match DB after host gets them
+			err = cudaMemcpy(RndPnts, Kparams.Kangs, KangCnt * 96, cudaMemcpyDeviceToHost);
+			if (err != cudaSuccess)
+			{
+				printf("GPU %d, cudaMemcpy failed: %s\r\n", CudaIndex, cudaGetErrorString(err));
+				gTotalErrors++;
+				break;
+			}
+			Paused = true;
+			while (PauseFlag && !StopFlag)
+				Sleep(1);
+			Paused = false;
+		}
 	}
-
-	Release();
+	Active = false;
 }
 
 ////Show MAX_DP_CNT and CNT in Print Output for Debugging
@@ -30,7 +30,15 @@ class RCGpuKang
 {
 private:
 	bool StopFlag;
-	EcPoint PntToSolve;
+	volatile bool PauseFlag; //checkpoint: kangs are copied to host, then thread waits until Resume
+	volatile bool Paused;
+	volatile bool Active; //Execute is running or is going to run for current targets
+	u8* ResumeKangs; //kangs from checkpoint for next Start, NULL - random kangs
+	EcPoint Targets[MAX_TARGET_CNT];
+	u8 TargetIds[MAX_TARGET_CNT]; //target index that is stored in DP type byte
+	int TargetCnt;
+	bool KeepKangs; //next Start keeps tames and wilds of unchanged targets from previous run
+	bool KeepWilds[MAX_TARGET_CNT];
 	int Range; //in bits
 	int DP; //in bits
 	Ec ec;
@@ -46,15 +54,22 @@ private:
 	EcJMP* EcJumps2;
 	EcJMP* EcJumps3;
 
-	EcPoint PntA;
-	EcPoint PntB;
+	EcPoint PntA[MAX_TARGET_CNT];
+	EcPoint PntB[MAX_TARGET_CNT];
 
 	int cur_stats_ind;
 	int SpeedStats[STATS_WND_SIZE];
 
+	int NodeId; //"-node-id" mode: kangs are derived from (node, epoch, gpu, herd, kang) instead of rnd
+	int NodeCnt; //0 - rnd kangs
+	u64 NodeEpoch;
+	int NodeGpu; //gpu index in the node
+	u32 HerdCnt; //herds generated since SetNode, every Start without checkpoint makes new herd
+
+	//kangs of every type are split into TargetCnt groups: slot / TargetCnt is kang type, slot % TargetCnt is target
+	int GetKangSlot(int kang_ind) { return (int)((u64)kang_ind * 3 * TargetCnt / KangCnt); }
 	void GenerateRndDistances();
 	bool Start();
-	void Release();
 #ifdef DEBUG_MODE
 	int Dbg_CheckKangs();
 #endif
@@ -67,8 +82,18 @@ public:
 	bool IsOldGpu;
 
 	int CalcKangCnt();
-	bool Prepare(EcPoint _PntToSolve, int _Range, int _DP, EcJMP* _EcJumps1, EcJMP* _EcJumps2, EcJMP* _EcJumps3);
+	bool Prepare(int _Range, int _DP, EcJMP* _EcJumps1, EcJMP* _EcJumps2, EcJMP* _EcJumps3);
+	void SetTargets(EcPoint* _Targets, u8* _TargetIds, int _TargetCnt, bool keep_kangs);
+	void Release();
 	void Stop();
+	void SetDPExtMask(u64 mask) { Kparams.DPExtMask = mask; } //used by next kernel call
+	void SetDP(int _DP) { DP = _DP; Kparams.DP = _DP; } //used by next kernel call
+	void SetResumeKangs(u8* kangs);
+	void SetNode(int node_id, int node_cnt, u64 epoch, int gpu_ind);
+	void Pause() { PauseFlag = true; }
+	bool WaitPaused();
+	u8* GetKangs() { return (u8*)RndPnts; } //valid while paused, KangCnt * 96 bytes
+	void Resume() { PauseFlag = false; }
 	void Execute();
 
 	u32 dbg[256];
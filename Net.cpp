@@ -0,0 +1,396 @@
+// Net.cpp
+//
+// This file is a part of RCKangaroo software
+// (c) 2024, RetiredCoder (RC)
+// License: GPLv3, see "LICENSE.TXT" file
+// https://github.com/RetiredC
+
+
+#ifdef _WIN32
+
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+#define SOCK_INVALID		((u64)INVALID_SOCKET)
+#define SOCK(s)				((SOCKET)(s))
+#define closesocket_		closesocket
+
+#else
+
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <signal.h>
+#include <string.h>
+#define SOCK_INVALID		((u64)-1)
+#define SOCK(s)				((int)(s))
+#define closesocket_		close
+
+#endif
+
+#include <stdio.h>
+#include <algorithm>
+#include "Net.h"
+#include "utils.h"
+
+//socket buffers, large batches of DPs must not block sender
+#define NET_SOCK_BUF_SIZE	(4 * 1024 * 1024)
+
+bool NetInit()
+{
+#ifdef _WIN32
+	WSADATA wsa;
+	return WSAStartup(MAKEWORD(2, 2), &wsa) == 0;
+#else
+	signal(SIGPIPE, SIG_IGN); //send to closed connection returns error instead
+	return true;
+#endif
+}
+
+static void SetSockOptions(u64 sock)
+{
+	int val = NET_SOCK_BUF_SIZE;
+	setsockopt(SOCK(sock), SOL_SOCKET, SO_SNDBUF, (char*)&val, sizeof(val));
+	setsockopt(SOCK(sock), SOL_SOCKET, SO_RCVBUF, (char*)&val, sizeof(val));
+	val = 1;
+	setsockopt(SOCK(sock), IPPROTO_TCP, TCP_NODELAY, (char*)&val, sizeof(val)); //every message is sent by one call
+}
+
+TcpSocket::TcpSocket()
+{
+	sock = SOCK_INVALID;
+}
+
+TcpSocket::~TcpSocket()
+{
+	Close();
+}
+
+bool TcpSocket::IsOpen()
+{
+	return sock != SOCK_INVALID;
+}
+
+void TcpSocket::Close()
+{
+	if (sock == SOCK_INVALID)
+		return;
+	closesocket_(SOCK(sock));
+	sock = SOCK_INVALID;
+}
+
+bool TcpSocket::Listen(int port)
+{
+	Close();
+	sock = (u64)socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (sock == SOCK_INVALID)
+		return false;
+	int val = 1;
+	setsockopt(SOCK(sock), SOL_SOCKET, SO_REUSEADDR, (char*)&val, sizeof(val));
+	sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	addr.sin_port = htons((u16)port);
+	if (bind(SOCK(sock), (sockaddr*)&addr, sizeof(addr)) || listen(SOCK(sock), 64))
+	{
+		Close();
+		return false;
+	}
+	return true;
+}
+
+//addr_str receives "ip:port" of the client, at least 32 chars
+bool TcpSocket::Accept(TcpSocket* client, char* addr_str)
+{
+	sockaddr_in addr;
+	socklen_t len = sizeof(addr);
+	u64 s = (u64)accept(SOCK(sock), (sockaddr*)&addr, &len);
+	if (s == SOCK_INVALID)
+		return false;
+	client->Close();
+	client->sock = s;
+	SetSockOptions(s);
+	u8* ip = (u8*)&addr.sin_addr;
+	sprintf(addr_str, "%d.%d.%d.%d:%d", ip[0], ip[1], ip[2], ip[3], ntohs(addr.sin_port));
+	return true;
+}
+
+bool TcpSocket::Connect(char* host, int port)
+{
+	Close();
+	addrinfo hints, *res;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_STREAM;
+	char port_str[16];
+	sprintf(port_str, "%d", port);
+	if (getaddrinfo(host, port_str, &hints, &res))
+		return false;
+	sock = (u64)socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	bool ok = (sock != SOCK_INVALID);
+	if (ok)
+	{
+		SetSockOptions(sock);
+		ok = !connect(SOCK(sock), res->ai_addr, (int)res->ai_addrlen);
+	}
+	freeaddrinfo(res);
+	if (!ok)
+		Close();
+	return ok;
+}
+
+int TcpSocket::WaitRead(int ms)
+{
+	fd_set fds;
+	FD_ZERO(&fds);
+	FD_SET(SOCK(sock), &fds);
+	timeval tv;
+	tv.tv_sec = ms / 1000;
+	tv.tv_usec = (ms % 1000) * 1000;
+	int res = select((int)(SOCK(sock) + 1), &fds, NULL, NULL, &tv);
+	if (res < 0)
+		return -1;
+	return res ? 1 : 0;
+}
+
+bool TcpSocket::SendAll(void* data, int size)
+{
+	char* p = (char*)data;
+	while (size > 0)
+	{
+		int res = send(SOCK(sock), p, size, 0);
+		if (res <= 0)
+			return false;
+		p += res;
+		size -= res;
+	}
+	return true;
+}
+
+bool TcpSocket::RecvAll(void* data, int size)
+{
+	char* p = (char*)data;
+	while (size > 0)
+	{
+		int res = recv(SOCK(sock), p, size, 0);
+		if (res <= 0)
+			return false;
+		p += res;
+		size -= res;
+	}
+	return true;
+}
+
+//header and payload are sent by one call
+bool TcpSocket::SendMsg(u32 type, void* data, u32 len)
+{
+	std::vector <u8> buf(sizeof(TNetMsgHdr) + len);
+	TNetMsgHdr* hdr = (TNetMsgHdr*)buf.data();
+	hdr->type = type;
+	hdr->len = len;
+	if (len)
+		memcpy(buf.data() + sizeof(TNetMsgHdr), data, len);
+	return SendAll(buf.data(), (int)buf.size());
+}
+
+bool TcpSocket::RecvMsg(TNetMsgHdr* hdr, std::vector <u8>& buf)
+{
+	if (!RecvAll(hdr, sizeof(TNetMsgHdr)) || (hdr->len > NET_MAX_MSG_LEN))
+		return false;
+	buf.resize(hdr->len);
+	return !hdr->len || RecvAll(buf.data(), hdr->len);
+}
+
+//DB record is DBRec: X, distance, type
+#define REC_X_LEN			((int)sizeof(((DBRec*)0)->x))
+#define REC_D_LEN			((int)sizeof(((DBRec*)0)->d))
+
+struct TPackSortItem
+{
+	u64 key;
+	u32 ind;
+	bool operator < (const TPackSortItem& other) const { return key < other.key; }
+};
+
+//first 8 bytes of X as big-endian number, so sorted keys have the same order as DB prefixes
+static inline u64 PackKey(u8* rec)
+{
+	u64 key = 0;
+	for (int i = 0; i < 8; i++)
+		key = (key << 8) | rec[i];
+	return key;
+}
+
+static inline u8* PutVarint(u8* p, u64 val)
+{
+	while (val >= 0x80)
+	{
+		*p++ = (u8)val | 0x80;
+		val >>= 7;
+	}
+	*p++ = (u8)val;
+	return p;
+}
+
+//returns NULL if varint is longer than max_bytes or data ends
+static inline u8* GetVarint(u8* p, u8* end, u64* val, int max_bytes)
+{
+	u64 res = 0;
+	for (int i = 0; (i < max_bytes) && (p < end); i++)
+	{
+		u8 b = *p++;
+		res |= (u64)(b & 0x7F) << (7 * i);
+		if (!(b & 0x80))
+		{
+			*val = res;
+			return p;
+		}
+	}
+	return NULL;
+}
+
+//192-bit two's complement negation
+static inline void Neg192(u64* w)
+{
+	w[0] = ~w[0];
+	w[1] = ~w[1];
+	w[2] = ~w[2];
+	if (!++w[0] && !++w[1])
+		++w[2];
+}
+
+static inline u8* PutDist(u8* p, u8* d)
+{
+	u64 w[3];
+	bool neg = (d[REC_D_LEN - 1] == 0xFF); //negative distances are sign-extended with 0xFF
+	memset(w, neg ? 0xFF : 0, sizeof(w));
+	memcpy(w, d, REC_D_LEN);
+	if (neg)
+		Neg192(w);
+	w[2] = (w[2] << 1) | (w[1] >> 63);
+	w[1] = (w[1] << 1) | (w[0] >> 63);
+	w[0] = (w[0] << 1) | (neg ? 1 : 0);
+	do
+	{
+		u8 b = (u8)w[0] & 0x7F;
+		w[0] = (w[0] >> 7) | (w[1] << 57);
+		w[1] = (w[1] >> 7) | (w[2] << 57);
+		w[2] >>= 7;
+		bool more = (w[0] | w[1] | w[2]) != 0;
+		*p++ = b | (more ? 0x80 : 0);
+		if (!more)
+			break;
+	} while (1);
+	return p;
+}
+
+static inline u8* GetDist(u8* p, u8* end, u8* d)
+{
+	u64 w[3] = { 0, 0, 0 };
+	int shift = 0;
+	while (1)
+	{
+		if ((p >= end) || (shift > 7 * 25))
+			return NULL;
+		u64 b = *p & 0x7F;
+		int word = shift / 64;
+		int bit = shift % 64;
+		w[word] |= b << bit;
+		if ((bit > 57) && (word < 2))
+			w[word + 1] |= b >> (64 - bit);
+		shift += 7;
+		if (!(*p++ & 0x80))
+			break;
+	}
+	bool neg = w[0] & 1;
+	w[0] = (w[0] >> 1) | (w[1] << 63);
+	w[1] = (w[1] >> 1) | (w[2] << 63);
+	w[2] >>= 1;
+	if (neg)
+		Neg192(w);
+	memcpy(d, w, REC_D_LEN);
+	return p;
+}
+
+//encodes DB records (DB_FULL_REC_LEN bytes each), out must have NET_PACKED_MAX_LEN(cnt) bytes, returns encoded size
+int NetEncodeDPs(u8* recs, int cnt, u8* out)
+{
+	//keys are uniform, so bucket by top bits and sort small buckets
+	int bits = 1;
+	while ((bits < 16) && ((1 << bits) < cnt))
+		bits++;
+	std::vector <u32> pos((1 << bits) + 1, 0);
+	for (int i = 0; i < cnt; i++)
+		pos[(recs[(u64)i * DB_FULL_REC_LEN] << 8 | recs[(u64)i * DB_FULL_REC_LEN + 1]) >> (16 - bits)]++;
+	u32 sum = 0;
+	for (int i = 0; i <= (1 << bits); i++)
+	{
+		u32 c = pos[i];
+		pos[i] = sum;
+		sum += c;
+	}
+	std::vector <TPackSortItem> items(cnt);
+	for (int i = 0; i < cnt; i++)
+	{
+		u8* rec = recs + (u64)i * DB_FULL_REC_LEN;
+		TPackSortItem* item = &items[pos[(rec[0] << 8 | rec[1]) >> (16 - bits)]++];
+		item->key = PackKey(rec);
+		item->ind = i;
+	}
+	for (int i = 0, start = 0; i < (1 << bits); i++)
+	{
+		if (pos[i] - start > 1)
+			std::sort(items.begin() + start, items.begin() + pos[i]);
+		start = pos[i];
+	}
+	u8* p = out;
+	*(u32*)p = cnt;
+	p += 4;
+	u64 prev = 0;
+	for (int i = 0; i < cnt; i++)
+	{
+		u8* rec = recs + (u64)items[i].ind * DB_FULL_REC_LEN;
+		p = PutVarint(p, items[i].key - prev);
+		prev = items[i].key;
+		memcpy(p, rec + 8, REC_X_LEN - 8);
+		p += REC_X_LEN - 8;
+		p = PutDist(p, rec + REC_X_LEN);
+		*p++ = rec[DB_FULL_REC_LEN - 1];
+	}
+	return (int)(p - out);
+}
+
+//decodes batch made by NetEncodeDPs, returns number of records or -1 if data is corrupted
+int NetDecodeDPs(u8* data, int len, u8* recs, int max_cnt)
+{
+	if (len < 4)
+		return -1;
+	u32 cnt = *(u32*)data;
+	if (cnt > (u32)max_cnt)
+		return -1;
+	u8* p = data + 4;
+	u8* end = data + len;
+	u64 key = 0;
+	for (u32 i = 0; i < cnt; i++)
+	{
+		u8* rec = recs + (u64)i * DB_FULL_REC_LEN;
+		u64 delta;
+		p = GetVarint(p, end, &delta, 10);
+		if (!p || (end - p < REC_X_LEN - 8))
+			return -1;
+		key += delta;
+		for (int j = 0; j < 8; j++)
+			rec[j] = (u8)(key >> (56 - 8 * j));
+		memcpy(rec + 8, p, REC_X_LEN - 8);
+		p += REC_X_LEN - 8;
+		p = GetDist(p, end, rec + REC_X_LEN);
+		if (!p || (p >= end))
+			return -1;
+		rec[DB_FULL_REC_LEN - 1] = *p++;
+	}
+	return (p == end) ? (int)cnt : -1;
+}
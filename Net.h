@@ -0,0 +1,77 @@
+// Net.h
+//
+// This file is a part of RCKangaroo software
+// (c) 2024, RetiredCoder (RC)
+// License: GPLv3, see "LICENSE.TXT" file
+// https://github.com/RetiredC
+
+
+#pragma once
+
+#include <vector>
+#include "defs.h"
+
+//DP server protocol: every message is TNetMsgHdr and "len" bytes of payload, little endian
+#define NET_VERSION			4
+#define NET_MSG_HELLO		1	//client -> server: TNetHello, server answers with TNetHello, status 0 if accepted
+#define NET_MSG_DPS			2	//client -> server: u64 ops since last message, then DB records (DB_FULL_REC_LEN bytes each)
+#define NET_MSG_STOP		3	//server -> client: point is solved, 32 bytes of private key (relative to start), client forwards it to other shards
+#define NET_MSG_DPS_PACKED	4	//client -> server: u64 ops since last message, then batch encoded by NetEncodeDPs
+#define NET_MAX_MSG_LEN		(64 * 1024 * 1024)
+//DB can be split between several servers by first byte of X
+#define NET_MAX_SHARDS		64
+
+//packed batch: u32 count, then records sorted by X: varint of delta of first 8 bytes of X (big-endian),
+//4 more bytes of X, distance as varint of (abs(d) << 1 | sign), type byte
+#define NET_PACKED_MAX_REC_LEN	(10 + 4 + 26 + 1)
+#define NET_PACKED_MAX_LEN(cnt)	(4 + (u64)(cnt) * NET_PACKED_MAX_REC_LEN)
+
+#pragma pack(push, 1)
+struct TNetMsgHdr
+{
+	u32 type;
+	u32 len;
+};
+
+struct TNetHello
+{
+	char sign[8];
+	u32 version;
+	u32 range;
+	u32 dp;
+	u32 status;
+	u16 shard; //index of the server in client's list, must match server's -shard
+	u16 shard_cnt;
+	u64 jump_hash; //all clients must use the same jumps
+	u8 pnt[64]; //point to solve, x and y
+	u32 gpu_dp; //DP of GPUs, server answers with DP of its tames and clients switch to it
+	u32 dp_ext_mask; //bits of x[1] that must be zero too, see gDPExtMask
+};
+#pragma pack(pop)
+
+//shard of DB record, first byte of X is split into shard_cnt equal ranges
+inline int NetShard(u8* rec, int shard_cnt) { return (rec[0] * shard_cnt) >> 8; }
+
+bool NetInit();
+int NetEncodeDPs(u8* recs, int cnt, u8* out);
+int NetDecodeDPs(u8* data, int len, u8* recs, int max_cnt);
+
+//blocking TCP socket
+class TcpSocket
+{
+private:
+	u64 sock;
+public:
+	TcpSocket();
+	~TcpSocket();
+	bool IsOpen();
+	void Close();
+	bool Listen(int port);
+	bool Accept(TcpSocket* client, char* addr_str);
+	bool Connect(char* host, int port);
+	int WaitRead(int ms); //1 - data or connection is ready, 0 - timeout, -1 - error
+	bool SendAll(void* data, int size);
+	bool RecvAll(void* data, int size);
+	bool SendMsg(u32 type, void* data, u32 len);
+	bool RecvMsg(TNetMsgHdr* hdr, std::vector <u8>& buf);
+};
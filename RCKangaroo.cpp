@@ -8,6 +8,7 @@
 
 #include <iostream>
 #include <vector>
+#include <signal.h>
 
 #include "cuda_runtime.h"
 #include "cuda.h"
@@ -15,6 +16,10 @@
 #include "defs.h"
 #include "utils.h"
 #include "GpuKang.h"
+#include "Bench.h"
+#include "Net.h"
+#include "Shm.h"
+#include "Tames.h"
 
 
 // Global variables and structures
@@ -38,8 +43,10 @@ u8* pPntList;
 u8* pPntList2;
 volatile int PntIndex;
 TFastBase db;
-EcPoint gPntToSolve;
-EcInt gPrivKey;
+EcPoint gTargets[MAX_TARGET_CNT]; //points to solve, index is stored in DP type byte
+EcInt gTargetKeys[MAX_TARGET_CNT];
+volatile bool gTargetSolved[MAX_TARGET_CNT];
+int gTargetCnt;
 
 volatile u64 TotalOps;
 u32 TotalSolved;
@@ -48,25 +55,129 @@ u64 PntTotalOps;
 bool IsBench;
 
 u32 gDP;
+bool gDpAuto; //"-dp auto", DP is selected for every range from gRamLimit
+double gRamLimit; //GB, 0 - not set
+double gDbRecCost; //measured DB bytes per record
+u64 gDbFixedBytes; //measured DB bytes that don't depend on records count
+u32 gDPExtMask; //DP raised under memory pressure: these bits of x[1] must be zero too
+int gGpuDP; //DP bits of x[3] used by GPUs in the session, lower than DP if tames file has lower DP
+u32 gTamesExtMask; //initial gDPExtMask of every point, tames file with lower DP is filtered with it
+u64 gJumpSeed; //rnd seed for jumps, tames from file need the same seed
+u64 gJumpHash; //hash of jumps of the session, see CalcJumpHash
+char gCheckpointFileName[1024];
+double gCheckpointInterval; //minutes
+bool gResume;
+DPJournal gJournal; //DPs added to DB since start of the run, checkpoints don't write DB if it's enabled
+double gJournalSync; //seconds between fsync of journal, 0 - no journal
+u64 gRunId; //journal must have the same id as checkpoint
+bool gTamesExtend; //gen mode adds new tames to existing tames file
+u64 gTamesOps; //ops of loaded tames file
+char gWildsFileName[1024]; //wild DPs of unsolved point are saved here and loaded by next attempt
+u64 gWildsOps; //ops of previous attempts
+int gServerPort; //"-server" mode: DPs of all clients are collected here, 0 - off
+int gShardIndex; //"-server" mode: this server keeps DPs of this shard only, see NetShard
+int gShardCnt;
+int gServerCnt; //"-client" mode: DPs are sent to these servers (shards) instead of local DB, 0 - off
+char gServerHost[NET_MAX_SHARDS][256];
+int gServerHostPort[NET_MAX_SHARDS];
+TcpSocket gServerConn[NET_MAX_SHARDS];
+std::vector <u8> gNetBuf;
+std::vector <u8> gShardBuf; //records grouped by shard
+u64 gNetSentOps; //ops already reported to server
+char gShmServerName[256]; //"-shm-server" mode: server also collects DPs of local processes from shared memory, see Shm.h
+char gShmClientName[256]; //"-shm-client" mode: DPs are written to shared memory of local "-shm-server" instead of local DB
+ShmRegion gShm;
+int gShmSlot; //"-shm-client" mode: slot of this process, -1 - not attached
+u64 gShmOpsBase; //PntTotalOps when slot was taken
+char gTamesServerName[256]; //"-tames-server" mode: tames file is loaded once and local solvers look up their wilds in it through shared memory
+char gTamesServiceName[256]; //"-tames-service": tames are looked up in local "-tames-server" instead of loading "-tames" file to local DB
+ShmRegion gTamesShm;
+int gTamesSlot; //-1 - not attached
+u64 gTamesReqSeq; //last request sent to tames service
+std::vector <u8> gTamesReq; //records of the last request, answers refer to them by index
 u32 gRange;
 EcInt gStart;
 bool gStartSet;
 EcPoint gPubKey;
+char gPubKeysFileName[1024];
+char gJobsFileName[1024];
+char gResultsFileName[1024];
+int gBenchDpMin; //DP sweep benchmark, 0 - off
+int gBenchDpMax;
+int gBenchDpCnt; //points per DP value
+TDbStats gLastDbStats; //DB stats at the end of the last SolvePoints call
 u8 gGPUs_Mask[MAX_GPU_CNT];
 char gTamesFileName[1024];
 double gMax;
 bool gGenMode; //tames generation mode
 bool gIsOpsLimit;
+u64 gDbBenchCnt;
+u64 gWireBenchCnt;
+std::vector <char*> gTamesMergeFiles; //"-tames-merge" tool: these files are merged into gTamesOutFileName
+char gTamesOutFileName[1024]; //output of tames tools
+int gTamesDP; //tames are filtered to this DP on load, or by "-tames-out" tool, 0 - off
+double gTamesVerify; //"-tames-verify" tool: percent of records of gTamesFileName to check, 0 - off
+int gNodeId; //"-node-id" mode: kangs are derived from node index instead of rnd, see RCGpuKang::SetNode
+int gNodeCnt; //0 - off
+u64 gNodeEpoch;
+int gDbHugeMode;
+int gDbNumaMode;
 
 #pragma pack(push, 1)
-struct DBRec
+//checkpoint file: header, then for every GPU u32 kang count and kangs (x, y, distance, 96 bytes each), then DB
+struct TCheckpointHeader
 {
-	u8 x[12];
-	u8 d[22];
-	u8 type; //0 - tame, 1 - wild1, 2 - wild2
+	char sign[8];
+	u32 version;
+	u32 range;
+	u32 dp;
+	u32 dp_ext_mask;
+	u64 jump_seed;
+	u64 total_ops;
+	u8 pnt[64]; //point to solve, x and y
+	u32 gpu_cnt;
+	u32 flags;
+	u64 run_id;
+	u64 journal_len; //journal bytes that match this checkpoint
+};
+
+struct TJournalHeader
+{
+	char sign[8];
+	u32 version;
+	u32 range;
+	u32 dp;
+	u8 pnt[64];
+	u64 run_id;
+	u8 reserved[JOURNAL_HEADER_SIZE - 92];
 };
 #pragma pack(pop)
 
+//pair of records with same X, waiting for verification in collision thread
+struct TCollisionCand
+{
+	DBRec nrec;
+	DBRec pref;
+};
+
+CriticalSection csCollisions;
+std::vector <TCollisionCand> CollisionList;
+volatile bool gCollisionThrStop;
+volatile u32 gCollisionsChecked;
+volatile u32 gMirrorCollisions;
+volatile u32 gFalseMatches;
+
+//solver session: jumps, GPU buffers and GPU threads are prepared once per (range, DP) and reused for all points
+int gSessionRange;
+int gSessionDP;
+volatile u32 gSessionRun; //incremented to start GPU threads for the next point
+volatile bool gSessionExit;
+#ifdef _WIN32
+HANDLE gThrHandles[MAX_GPU_CNT];
+#else
+pthread_t gThrHandles[MAX_GPU_CNT];
+#endif
+
 /**
  * @brief Initializes the available GPUs.
  */
@@ -127,6 +238,8 @@ void InitGpus()
 /**
  * @brief Thread procedure for GPU execution on Windows.
  *
+ * Thread lives for the whole session and runs Execute for every point.
+ *
  * @param data Pointer to the RCGpuKang object.
  * @return u32
  */
@@ -134,13 +247,25 @@ void InitGpus()
 u32 __stdcall kang_thr_proc(void* data)
 {
 	RCGpuKang* Kang = (RCGpuKang*)data;
-	Kang->Execute();
-	InterlockedDecrement(&ThrCnt);
+	u32 run = 0;
+	while (!gSessionExit)
+	{
+		if (run == gSessionRun)
+		{
+			Sleep(1);
+			continue;
+		}
+		run = gSessionRun;
+		Kang->Execute();
+		InterlockedDecrement(&ThrCnt);
+	}
 	return 0;
 }
 /**
  * @brief Thread procedure for GPU execution on Linux.
  *
+ * Thread lives for the whole session and runs Execute for every point.
+ *
  * @param data Pointer to the RCGpuKang object.
  * @return void*
  */
@@ -148,8 +273,18 @@ u32 __stdcall kang_thr_proc(void* data)
 void* kang_thr_proc(void* data)
 {
 	RCGpuKang* Kang = (RCGpuKang*)data;
-	Kang->Execute();
-	__sync_fetch_and_sub(&ThrCnt, 1);
+	u32 run = 0;
+	while (!gSessionExit)
+	{
+		if (run == gSessionRun)
+		{
+			Sleep(1);
+			continue;
+		}
+		run = gSessionRun;
+		Kang->Execute();
+		__sync_fetch_and_sub(&ThrCnt, 1);
+	}
 	return 0;
 }
 #endif
@@ -186,477 +321,1093 @@ void AddPointsToList(u32* data, int pnt_cnt, u64 ops_cnt)
  * @param w The wild kangaroo distance.
  * @param WildType The type of the wild kangaroo.
  * @param IsNeg Whether to negate the distance.
+ * @param ec_ctx EC context of the calling thread.
+ * @param pk The resulting private key.
  * @return true If a collision is found.
  * @return false Otherwise.
  */
 
-bool Collision_SOTA(EcPoint& pnt, EcInt t, int TameType, EcInt w, int WildType, bool IsNeg)
+bool Collision_SOTA(EcPoint& pnt, EcInt t, int TameType, EcInt w, int WildType, bool IsNeg, Ec& ec_ctx, EcInt& pk)
 {
 	if (IsNeg)
 		t.Neg();
 	if (TameType == TAME)
 	{
-		gPrivKey = t;
-		gPrivKey.Sub(w);
-		EcInt sv = gPrivKey;
-		gPrivKey.Add(Int_HalfRange);
-		EcPoint P = ec.MultiplyG(gPrivKey);
+		pk = t;
+		pk.Sub(w);
+		EcInt sv = pk;
+		pk.Add(Int_HalfRange);
+		EcPoint P = ec_ctx.MultiplyG(pk);
 		if (P.IsEqual(pnt))
 			return true;
-		gPrivKey = sv;
-		gPrivKey.Neg();
-		gPrivKey.Add(Int_HalfRange);
-		P = ec.MultiplyG(gPrivKey);
+		pk = sv;
+		pk.Neg();
+		pk.Add(Int_HalfRange);
+		P = ec_ctx.MultiplyG(pk);
 		return P.IsEqual(pnt);
 	}
 	else
 	{
-		gPrivKey = t;
-		gPrivKey.Sub(w);
-		if (gPrivKey.data[4] >> 63)
-			gPrivKey.Neg();
-		gPrivKey.ShiftRight(1);
-		EcInt sv = gPrivKey;
-		gPrivKey.Add(Int_HalfRange);
-		EcPoint P = ec.MultiplyG(gPrivKey);
+		pk = t;
+		pk.Sub(w);
+		if (pk.data[4] >> 63)
+			pk.Neg();
+		pk.ShiftRight(1);
+		EcInt sv = pk;
+		pk.Add(Int_HalfRange);
+		EcPoint P = ec_ctx.MultiplyG(pk);
 		if (P.IsEqual(pnt))
 			return true;
-		gPrivKey = sv;
-		gPrivKey.Neg();
-		gPrivKey.Add(Int_HalfRange);
-		P = ec.MultiplyG(gPrivKey);
+		pk = sv;
+		pk.Neg();
+		pk.Add(Int_HalfRange);
+		P = ec_ctx.MultiplyG(pk);
 		return P.IsEqual(pnt);
 	}
 }
 
 /**
- * @brief Checks for new points and processes them.
+ * @brief Verifies a collision candidate, executes in collision thread.
+ *
+ * @param ec_ctx EC context of the collision thread.
+ * @param cand The candidate.
  */
 
-void CheckNewPoints()
+void VerifyCollision(Ec& ec_ctx, TCollisionCand* cand)
 {
-	csAddPoints.Enter();
-	if (!PntIndex)
-	{
-		csAddPoints.Leave();
+	DBRec* nrec = &cand->nrec;
+	DBRec* pref = &cand->pref;
+	EcInt w, t;
+	int TameType, WildType;
+	int target = (((pref->type & KANG_TYPE_MASK) != TAME) ? pref->type : nrec->type) >> TARGET_SHIFT;
+	if (gTargetSolved[target])
 		return;
+	if ((pref->type & KANG_TYPE_MASK) != TAME)
+	{
+		memcpy(w.data, pref->d, sizeof(pref->d));
+		if (pref->d[21] == 0xFF) memset(((u8*)w.data) + 22, 0xFF, 18);
+		memcpy(t.data, nrec->d, sizeof(nrec->d));
+		if (nrec->d[21] == 0xFF) memset(((u8*)t.data) + 22, 0xFF, 18);
+		TameType = nrec->type & KANG_TYPE_MASK;
+		WildType = pref->type & KANG_TYPE_MASK;
 	}
-
-	int cnt = PntIndex;
-	memcpy(pPntList2, pPntList, GPU_DP_SIZE * cnt);
-	PntIndex = 0;
-	csAddPoints.Leave();
-
-	for (int i = 0; i < cnt; i++)
+	else
 	{
-		DBRec nrec;
-		u8* p = pPntList2 + i * GPU_DP_SIZE;
-		memcpy(nrec.x, p, 12);
-		memcpy(nrec.d, p + 16, 22);
-		nrec.type = gGenMode ? TAME : p[40];
+		memcpy(w.data, nrec->d, sizeof(nrec->d));
+		if (nrec->d[21] == 0xFF) memset(((u8*)w.data) + 22, 0xFF, 18);
+		memcpy(t.data, pref->d, sizeof(pref->d));
+		if (pref->d[21] == 0xFF) memset(((u8*)t.data) + 22, 0xFF, 18);
+		TameType = TAME;
+		WildType = nrec->type & KANG_TYPE_MASK;
+	}
 
-		DBRec* pref = (DBRec*)db.FindOrAddDataBlock((u8*)&nrec);
-		if (gGenMode)
-			continue;
-		if (pref)
+	EcInt pk;
+	bool res = Collision_SOTA(gTargets[target], t, TameType, w, WildType, false, ec_ctx, pk) || Collision_SOTA(gTargets[target], t, TameType, w, WildType, true, ec_ctx, pk);
+	gCollisionsChecked++;
+	if (!res)
+	{
+		bool w12 = ((TameType == WILD1) && (WildType == WILD2)) || ((TameType == WILD2) && (WildType == WILD1));
+		if (w12) //in rare cases WILD and WILD2 can collide in mirror, in this case there is no way to find K
+			gMirrorCollisions++;
+		else
 		{
-			//in db we dont store first 3 bytes so restore them
-			DBRec tmp_pref;
-			memcpy(&tmp_pref, &nrec, 3);
-			memcpy(((u8*)&tmp_pref) + 3, pref, sizeof(DBRec) - 3);
-			pref = &tmp_pref;
-
-			if (pref->type == nrec.type)
-			{
-				if (pref->type == TAME)
-					continue;
-
-				//if it's wild, we can find the key from the same type if distances are different
-				if (*(u64*)pref->d == *(u64*)nrec.d)
-					continue;
-				//else
-				//	ToLog("key found by same wild");
-			}
-
-			EcInt w, t;
-			int TameType, WildType;
-			if (pref->type != TAME)
-			{
-				memcpy(w.data, pref->d, sizeof(pref->d));
-				if (pref->d[21] == 0xFF) memset(((u8*)w.data) + 22, 0xFF, 18);
-				memcpy(t.data, nrec.d, sizeof(nrec.d));
-				if (nrec.d[21] == 0xFF) memset(((u8*)t.data) + 22, 0xFF, 18);
-				TameType = nrec.type;
-				WildType = pref->type;
-			}
-			else
-			{
-				memcpy(w.data, nrec.d, sizeof(nrec.d));
-				if (nrec.d[21] == 0xFF) memset(((u8*)w.data) + 22, 0xFF, 18);
-				memcpy(t.data, pref->d, sizeof(pref->d));
-				if (pref->d[21] == 0xFF) memset(((u8*)t.data) + 22, 0xFF, 18);
-				TameType = TAME;
-				WildType = nrec.type;
-			}
-
-			bool res = Collision_SOTA(gPntToSolve, t, TameType, w, WildType, false) || Collision_SOTA(gPntToSolve, t, TameType, w, WildType, true);
-			if (!res)
-			{
-				bool w12 = ((pref->type == WILD1) && (nrec.type == WILD2)) || ((pref->type == WILD2) && (nrec.type == WILD1));
-				if (w12) //in rare cases WILD and WILD2 can collide in mirror, in this case there is no way to find K
-					;// ToLog("W1 and W2 collides in mirror");
-				else
-				{
-					printf("Collision Error\r\n");
-					gTotalErrors++;
-				}
-				continue;
-			}
-			gSolved = true;
-			break;
+			printf("Collision Error\r\n");
+			gFalseMatches++;
+			gTotalErrors++;
 		}
+		return;
+	}
+	csCollisions.Enter();
+	if (!gTargetSolved[target])
+	{
+		gTargetKeys[target] = pk;
+		gTargetSolved[target] = true;
+		gSolved = true;
 	}
+	csCollisions.Leave();
 }
 
 /**
-// An attempt to reduce the # of calcs performed by CheckNewPoints
-void CheckNewPoints()
+ * @brief Thread procedure for collision verification.
+ *
+ * Candidates are verified here so DP ingestion in main thread never waits for EC calculations.
+ *
+ * @param data Not used.
+ */
+#ifdef _WIN32
+u32 __stdcall collision_thr_proc(void* data)
+#else
+void* collision_thr_proc(void* data)
+#endif
 {
-	csAddPoints.Enter();
-	if (!PntIndex)
+	Ec ec_thr;
+	std::vector <TCollisionCand> list;
+	while (1)
 	{
-		csAddPoints.Leave();
-		return;
+		csCollisions.Enter();
+		list.swap(CollisionList);
+		csCollisions.Leave();
+		if (list.empty())
+		{
+			if (gCollisionThrStop)
+				break;
+			Sleep(1);
+			continue;
+		}
+		for (size_t i = 0; i < list.size(); i++)
+			VerifyCollision(ec_thr, &list[i]);
+		list.clear();
 	}
+	return 0;
+}
 
-	int cnt = PntIndex;
-	std::swap(pPntList, pPntList2); // Swap pointers instead of copying memory
-	PntIndex = 0;
-	csAddPoints.Leave();
+/**
+ * @brief Queues a point that is already in DB for verification.
+ *
+ * @param data The new DB record.
+ * @param found The DB record with the same X (without first 3 bytes).
+ * @param ctx Not used.
+ * @return true Always, batch processing is never stopped.
+ */
 
-	for (int i = 0; i < cnt; i++)
-	{
-		DBRec nrec;
-		u8* p = pPntList2 + i * GPU_DP_SIZE;
-		memcpy(nrec.x, p, 12);
-		memcpy(nrec.d, p + 16, 22);
-		nrec.type = gGenMode ? TAME : p[40];
+bool CheckCollision(u8* data, u8* found, void* ctx)
+{
+	TCollisionCand cand;
+	cand.nrec = *(DBRec*)data;
+	//in db we dont store first 3 bytes so restore them
+	memcpy(&cand.pref, data, 3);
+	memcpy(((u8*)&cand.pref) + 3, found, sizeof(DBRec) - 3);
 
-		DBRec* pref = (DBRec*)db.FindOrAddDataBlock((u8*)&nrec);
-		if (gGenMode)
-			continue;
-		if (pref)
-		{
-			//in db we dont store first 3 bytes so restore them
-			DBRec tmp_pref;
-			memcpy(&tmp_pref, &nrec, 3);
-			memcpy(((u8*)&tmp_pref) + 3, pref, sizeof(DBRec) - 3);
-			pref = &tmp_pref;
+	if ((cand.pref.type & KANG_TYPE_MASK) == (cand.nrec.type & KANG_TYPE_MASK))
+	{
+		if ((cand.pref.type & KANG_TYPE_MASK) == TAME)
+			return true;
+		if (cand.pref.type != cand.nrec.type)
+			return true; //same wild type of different targets, only relation between two keys
 
-			if (pref->type == nrec.type)
-			{
-				if (pref->type == TAME)
-					continue;
+		//if it's wild, we can find the key from the same type if distances are different
+		if (*(u64*)cand.pref.d == *(u64*)cand.nrec.d)
+			return true;
+		//else
+		//	ToLog("key found by same wild");
+	}
+	else
+		if (((cand.pref.type & KANG_TYPE_MASK) != TAME) && ((cand.nrec.type & KANG_TYPE_MASK) != TAME) && ((cand.pref.type >> TARGET_SHIFT) != (cand.nrec.type >> TARGET_SHIFT)))
+			return true; //wilds of different targets, such collision gives only relation between two keys
 
-				//if it's wild, we can find the key from the same type if distances are different
-				if (*(u64*)pref->d == *(u64*)nrec.d)
-					continue;
-			}
+	csCollisions.Enter();
+	CollisionList.push_back(cand);
+	csCollisions.Leave();
+	return true;
+}
 
-			EcInt w, t;
-			int TameType, WildType;
-			if (pref->type != TAME)
-			{
-				memcpy(w.data, pref->d, sizeof(pref->d));
-				if (pref->d[21] == 0xFF) memset(((u8*)w.data) + 22, 0xFF, 18);
-				memcpy(t.data, nrec.d, sizeof(nrec.d));
-				if (nrec.d[21] == 0xFF) memset(((u8*)t.data) + 22, 0xFF, 18);
-				TameType = nrec.type;
-				WildType = pref->type;
-			}
-			else
-			{
-				memcpy(w.data, nrec.d, sizeof(nrec.d));
-				if (nrec.d[21] == 0xFF) memset(((u8*)w.data) + 22, 0xFF, 18);
-				memcpy(t.data, pref->d, sizeof(pref->d));
-				if (pref->d[21] == 0xFF) memset(((u8*)t.data) + 22, 0xFF, 18);
-				TameType = TAME;
-				WildType = nrec.type;
-			}
+/**
+ * @brief Switches GPUs to DP of the DP server, server with tames uses DP of the tames (GPU DP and x[1] mask) instead of -dp.
+ *
+ * DPs of this process are not added to local DB, so local tames don't limit it.
+ *
+ * @param ans Hello answer of the server.
+ * @return false If DP of the server is not valid.
+ */
+bool ClientSetServerDP(TNetHello* ans)
+{
+	if ((ans->gpu_dp == (u32)gGpuDP) && (ans->dp_ext_mask == gDPExtMask))
+		return true;
+	if ((ans->gpu_dp < 4) || (ans->gpu_dp > 60) || (ans->gpu_dp + __popcnt64(ans->dp_ext_mask) > 60))
+		return false;
+	printf("server uses DP %d (tames), GPUs are switched to it\r\n", ans->gpu_dp + (int)__popcnt64(ans->dp_ext_mask));
+	gGpuDP = ans->gpu_dp;
+	gTamesExtMask = ans->dp_ext_mask; //next points start with this mask too
+	gDPExtMask = ans->dp_ext_mask;
+	for (int i = 0; i < GpuCnt; i++)
+	{
+		GpuKangs[i]->SetDP(gGpuDP);
+		GpuKangs[i]->SetDPExtMask(gDPExtMask);
+	}
+	return true;
+}
 
-			bool res = Collision_SOTA(gPntToSolve, t, TameType, w, WildType, false) || Collision_SOTA(gPntToSolve, t, TameType, w, WildType, true);
-			if (!res)
-			{
-				bool w12 = ((pref->type == WILD1) && (nrec.type == WILD2)) || ((pref->type == WILD2) && (nrec.type == WILD1));
-				if (w12) //in rare cases WILD and WILD2 can collide in mirror, in this case there is no way to find K
-					;// ToLog("W1 and W2 collides in mirror");
-				else
-				{
-					printf("Collision Error\r\n");
-					gTotalErrors++;
-				}
-				continue;
-			}
-			gSolved = true;
-			break;
+/**
+ * @brief Connects to DP servers (shards), server checks that the client solves the same point with the same range, DP and jumps.
+ *
+ * @param Pnt The point to solve.
+ * @param Range The range of the search.
+ * @param DP The DP value.
+ * @return true If all servers accepted the client.
+ */
+bool NetClientConnect(EcPoint& Pnt, int Range, int DP)
+{
+	for (int i = 0; i < gServerCnt; i++)
+	{
+		if (!gServerConn[i].Connect(gServerHost[i], gServerHostPort[i]))
+		{
+			printf("error: cannot connect to server %s:%d\r\n", gServerHost[i], gServerHostPort[i]);
+			return false;
+		}
+		TNetHello hello;
+		memset(&hello, 0, sizeof(hello));
+		memcpy(hello.sign, "RCKNET", 7);
+		hello.version = NET_VERSION;
+		hello.range = Range;
+		hello.dp = DP;
+		hello.shard = i;
+		hello.shard_cnt = gServerCnt;
+		hello.jump_hash = gJumpHash;
+		Pnt.SaveToBuffer64(hello.pnt);
+		hello.gpu_dp = gGpuDP;
+		hello.dp_ext_mask = gDPExtMask;
+		TNetMsgHdr hdr;
+		std::vector <u8> buf;
+		if (!gServerConn[i].SendMsg(NET_MSG_HELLO, &hello, sizeof(hello)) || !gServerConn[i].RecvMsg(&hdr, buf) ||
+			(hdr.type != NET_MSG_HELLO) || (buf.size() != sizeof(TNetHello)) || ((TNetHello*)buf.data())->status)
+		{
+			printf("error: server %s:%d rejected connection, use the same -pubkey, -start, -range and -dp as servers, list servers in -shard order\r\n", gServerHost[i], gServerHostPort[i]);
+			gServerConn[i].Close();
+			return false;
 		}
+		TNetHello* ans = (TNetHello*)buf.data();
+		if (i ? ((ans->gpu_dp != (u32)gGpuDP) || (ans->dp_ext_mask != gDPExtMask)) : !ClientSetServerDP(ans))
+		{
+			printf("error: server %s:%d uses DP %d, other servers use DP %d, all shards must load the same tames\r\n", gServerHost[i], gServerHostPort[i],
+				ans->gpu_dp + (int)__popcnt64(ans->dp_ext_mask), gGpuDP + (int)__popcnt64(gDPExtMask));
+			gServerConn[i].Close();
+			return false;
+		}
+		printf("Connected to server %s:%d\r\n", gServerHost[i], gServerHostPort[i]);
 	}
+	gNetSentOps = PntTotalOps;
+	return true;
 }
-*/
 
+/**
+ * @brief Returns true if connections to all servers are open.
+ */
+bool NetClientIsConnected()
+{
+	for (int i = 0; i < gServerCnt; i++)
+		if (!gServerConn[i].IsOpen())
+			return false;
+	return true;
+}
 
 /**
- * @brief Displays the current statistics of the computation.
+ * @brief Sends DB records to DP servers in packed format, every record goes to the shard of its first byte.
  *
- * @param tm_start The start time of the computation.
- * @param exp_ops The expected number of operations.
- * @param dp_val The DP value.
+ * Ops done since last batch are reported to the first server only.
+ *
+ * @param recs DB records, DB_FULL_REC_LEN bytes each.
+ * @param cnt Number of records.
  */
+void NetSendDPs(u8* recs, int cnt)
+{
+	if (!NetClientIsConnected())
+		return;
+	u64 ops = PntTotalOps;
+	//group records by shard
+	u8* shard_recs = recs;
+	int shard_pos[NET_MAX_SHARDS + 1];
+	memset(shard_pos, 0, sizeof(shard_pos));
+	if (gServerCnt > 1)
+	{
+		for (int i = 0; i < cnt; i++)
+			shard_pos[NetShard(recs + i * DB_FULL_REC_LEN, gServerCnt) + 1]++;
+		for (int i = 0; i < gServerCnt; i++)
+			shard_pos[i + 1] += shard_pos[i];
+		gShardBuf.resize((u64)cnt * DB_FULL_REC_LEN);
+		shard_recs = gShardBuf.data();
+		int pos[NET_MAX_SHARDS];
+		memcpy(pos, shard_pos, sizeof(pos));
+		for (int i = 0; i < cnt; i++)
+		{
+			u8* rec = recs + i * DB_FULL_REC_LEN;
+			memcpy(shard_recs + pos[NetShard(rec, gServerCnt)]++ * DB_FULL_REC_LEN, rec, DB_FULL_REC_LEN);
+		}
+	}
+	else
+		shard_pos[1] = cnt;
+	for (int i = 0; i < gServerCnt; i++)
+	{
+		int shard_cnt = shard_pos[i + 1] - shard_pos[i];
+		if (!shard_cnt && i)
+			continue;
+		gNetBuf.resize(sizeof(TNetMsgHdr) + 8 + NET_PACKED_MAX_LEN(shard_cnt));
+		TNetMsgHdr* hdr = (TNetMsgHdr*)gNetBuf.data();
+		hdr->type = NET_MSG_DPS_PACKED;
+		hdr->len = 8 + NetEncodeDPs(shard_recs + shard_pos[i] * DB_FULL_REC_LEN, shard_cnt, gNetBuf.data() + sizeof(TNetMsgHdr) + 8);
+		*(u64*)(gNetBuf.data() + sizeof(TNetMsgHdr)) = i ? 0 : ops - gNetSentOps;
+		if (!gServerConn[i].SendAll(gNetBuf.data(), sizeof(TNetMsgHdr) + hdr->len))
+		{
+			printf("Connection to server %s:%d lost\r\n", gServerHost[i], gServerHostPort[i]);
+			gServerConn[i].Close();
+			return;
+		}
+		if (!i)
+			gNetSentOps = ops; //ops are credited by the first shard as soon as it has them, failure of other shards must not resend them
+	}
+}
 
-void ShowStats(u64 tm_start, double exp_ops, double dp_val)
+/**
+ * @brief Checks messages from DP servers, a server sends the key when it finds the collision.
+ *
+ * The key is forwarded to other shards so they stop too.
+ */
+void NetClientPoll()
 {
-#ifdef DEBUG_MODE
-	for (int i = 0; i <= MD_LEN; i++)
+	for (int i = 0; i < gServerCnt; i++)
 	{
-		u64 val = 0;
-		for (int j = 0; j < GpuCnt; j++)
+		if (!gServerConn[i].IsOpen() || (gServerConn[i].WaitRead(0) <= 0))
+			continue;
+		TNetMsgHdr hdr;
+		std::vector <u8> buf;
+		if (!gServerConn[i].RecvMsg(&hdr, buf))
 		{
-			val += GpuKangs[j]->dbg[i];
+			printf("Connection to server %s:%d lost\r\n", gServerHost[i], gServerHostPort[i]);
+			gServerConn[i].Close();
+			return;
 		}
-		if (val)
-			printf("Loop size %d: %llu\r\n", i, val);
+		if ((hdr.type != NET_MSG_STOP) || (buf.size() != 32))
+			continue;
+		EcInt pk;
+		pk.Set(0);
+		memcpy(pk.data, buf.data(), 32);
+		printf("Server %s:%d found the key\r\n", gServerHost[i], gServerHostPort[i]);
+		for (int j = 0; j < gServerCnt; j++)
+			if ((j != i) && gServerConn[j].IsOpen())
+				gServerConn[j].SendMsg(NET_MSG_STOP, buf.data(), 32);
+		csCollisions.Enter();
+		gTargetKeys[0] = pk;
+		gTargetSolved[0] = true;
+		gSolved = true;
+		csCollisions.Leave();
+		return;
 	}
-#endif
+}
 
-	int speed = GpuKangs[0]->GetStatsSpeed();
-	for (int i = 1; i < GpuCnt; i++)
-		speed += GpuKangs[i]->GetStatsSpeed();
+/**
+ * @brief Attaches to local DP aggregator ("-shm-server"): takes a free slot and waits until the aggregator checks the hello.
+ *
+ * @param Pnt The point to solve.
+ * @param Range The range of the search.
+ * @param DP The DP value.
+ * @return true If the aggregator accepted this process.
+ */
+bool ShmClientConnect(EcPoint& Pnt, int Range, int DP)
+{
+	if (!gShm.Open(gShmClientName) || (gShm.GetSize() < SHM_TOTAL_SIZE))
+	{
+		printf("error: cannot open shared memory %s, start -shm-server first\r\n", gShmClientName);
+		gShm.Close();
+		return false;
+	}
+	TShmHeader* hdr = (TShmHeader*)gShm.GetData();
+	if (memcmp(hdr->sign, "RCKSHM", 7) || (hdr->version != SHM_VERSION) || (hdr->slot_cnt != SHM_SLOT_CNT) || (hdr->ring_recs != SHM_RING_RECS) ||
+		(GetTickCount64() - hdr->heartbeat > SHM_TIMEOUT))
+	{
+		printf("error: shared memory %s has different version or aggregator is not running\r\n", gShmClientName);
+		gShm.Close();
+		return false;
+	}
+	TShmSlot* slots = (TShmSlot*)(gShm.GetData() + sizeof(TShmHeader));
+	int ind = -1;
+	for (int i = 0; i < SHM_SLOT_CNT; i++)
+		if (ShmCas(&slots[i].state, SHM_SLOT_FREE, SHM_SLOT_TAKEN))
+		{
+			ind = i;
+			break;
+		}
+	if (ind < 0)
+	{
+		printf("error: all %d slots of shared memory %s are used\r\n", SHM_SLOT_CNT, gShmClientName);
+		gShm.Close();
+		return false;
+	}
+	TShmSlot* slot = &slots[ind];
+	memset(&slot->hello, 0, sizeof(slot->hello));
+	memcpy(slot->hello.sign, "RCKNET", 7);
+	slot->hello.version = NET_VERSION;
+	slot->hello.range = Range;
+	slot->hello.dp = DP;
+	slot->hello.shard_cnt = 1;
+	slot->hello.jump_hash = gJumpHash;
+	Pnt.SaveToBuffer64(slot->hello.pnt);
+	slot->hello.gpu_dp = gGpuDP;
+	slot->hello.dp_ext_mask = gDPExtMask;
+	slot->pid = ShmGetPid();
+	slot->ops = 0;
+	slot->head = 0;
+	slot->tail = 0;
+	slot->heartbeat = GetTickCount64();
+	ShmFence();
+	slot->state = SHM_SLOT_HELLO;
+	u64 tm = GetTickCount64();
+	while ((slot->state == SHM_SLOT_HELLO) && (GetTickCount64() - tm < 10 * 1000))
+		Sleep(1);
+	ShmFence(); //DP of aggregator in hello is written before the state
+	if ((slot->state != SHM_SLOT_ACTIVE) || !ClientSetServerDP(&slot->hello))
+	{
+		printf("error: aggregator %s rejected this process, use the same -pubkey, -start, -range and -dp as aggregator\r\n", gShmClientName);
+		slot->state = (slot->state == SHM_SLOT_ACTIVE) ? SHM_SLOT_CLOSED : SHM_SLOT_FREE;
+		gShm.Close();
+		return false;
+	}
+	gShmSlot = ind;
+	gShmOpsBase = PntTotalOps;
+	printf("Attached to aggregator %s, slot %d\r\n", gShmClientName, ind);
+	return true;
+}
 
-	u64 est_dps_cnt = (u64)(exp_ops / dp_val);
-	u64 exp_sec = 0xFFFFFFFFFFFFFFFFull;
-	if (speed)
-		exp_sec = (u64)((exp_ops / 1000000) / speed); //in sec
-	u64 exp_days = exp_sec / (3600 * 24);
-	u64 remaining_exp_sec = exp_sec % (3600 * 24);
-	int exp_hours = static_cast<int>(remaining_exp_sec / 3600);
-	remaining_exp_sec %= 3600;
-	int exp_min = static_cast<int>(remaining_exp_sec / 60);
-	double exp_full_sec = (remaining_exp_sec % 60) + 0.0;  // No fractional seconds for estimated
+/**
+ * @brief Releases the slot, aggregator reads the rest of its ring and frees it.
+ */
+void ShmClientClose()
+{
+	if (gShmSlot < 0)
+		return;
+	TShmSlot* slot = (TShmSlot*)(gShm.GetData() + sizeof(TShmHeader)) + gShmSlot;
+	ShmFence();
+	slot->state = SHM_SLOT_CLOSED;
+	gShm.Close();
+	gShmSlot = -1;
+}
 
-	u64 elapsed_sec = (GetTickCount64() - tm_start) / 1000;  // Total elapsed seconds
-	u64 elapsed_days = elapsed_sec / (3600 * 24);
-	u64 remaining_elapsed_sec = elapsed_sec % (3600 * 24);
-	int elapsed_hours = static_cast<int>(remaining_elapsed_sec / 3600);
-	remaining_elapsed_sec %= 3600;
-	int elapsed_minutes = static_cast<int>(remaining_elapsed_sec / 60);
-	double elapsed_full_sec = (remaining_elapsed_sec % 60) + ((GetTickCount64() - tm_start) % 1000) / 1000.0;
+/**
+ * @brief Updates heartbeat and ops of the slot and checks that the aggregator is alive.
+ *
+ * @return false If the aggregator is dead, the slot is released.
+ */
+bool ShmClientAlive()
+{
+	TShmHeader* hdr = (TShmHeader*)gShm.GetData();
+	TShmSlot* slot = (TShmSlot*)(gShm.GetData() + sizeof(TShmHeader)) + gShmSlot;
+	u64 tm = GetTickCount64();
+	slot->heartbeat = tm;
+	slot->ops = PntTotalOps - gShmOpsBase;
+	if ((tm - hdr->heartbeat > SHM_TIMEOUT) || (slot->state != SHM_SLOT_ACTIVE))
+	{
+		printf("Aggregator %s is not responding\r\n", gShmClientName);
+		ShmClientClose();
+		return false;
+	}
+	return true;
+}
 
-	printf("%sSpeed: %d MKeys/s, Err: %d, DPs: %lluK/%lluK, Time: %llud:%02dh:%02dm:%05.2fs/%llud:%02dh:%02dm:%05.2fs\r\n",
-		gGenMode ? "GEN: " : (IsBench ? "BENCH: " : "MAIN: "),
-		speed,
-		gTotalErrors,
-		db.GetBlockCnt() / 1000,
-		est_dps_cnt / 1000,
-		elapsed_days, elapsed_hours, elapsed_minutes, elapsed_full_sec,
-		exp_days, exp_hours, exp_min, exp_full_sec);
+/**
+ * @brief Writes DB records to the ring of this process, waits if the ring is full.
+ *
+ * @param recs DB records, DB_FULL_REC_LEN bytes each.
+ * @param cnt Number of records.
+ */
+void ShmSendDPs(u8* recs, int cnt)
+{
+	if (gShmSlot < 0)
+		return;
+	TShmHeader* hdr = (TShmHeader*)gShm.GetData();
+	TShmSlot* slot = (TShmSlot*)(gShm.GetData() + sizeof(TShmHeader)) + gShmSlot;
+	u8* ring = gShm.GetData() + SHM_RING_OFFSET(gShmSlot);
+	int pos = 0;
+	while (pos < cnt)
+	{
+		u64 head = slot->head;
+		u64 free_cnt = SHM_RING_RECS - (head - slot->tail);
+		if (!free_cnt)
+		{
+			if (!ShmClientAlive() || hdr->solved)
+				return;
+			Sleep(1);
+			continue;
+		}
+		u64 ind = head & (SHM_RING_RECS - 1);
+		u64 n = cnt - pos;
+		if (n > free_cnt)
+			n = free_cnt;
+		if (n > SHM_RING_RECS - ind)
+			n = SHM_RING_RECS - ind;
+		memcpy(ring + ind * DB_FULL_REC_LEN, recs + (u64)pos * DB_FULL_REC_LEN, n * DB_FULL_REC_LEN);
+		ShmFence(); //records must be visible before head
+		slot->head = head + n;
+		pos += (int)n;
+	}
+	ShmClientAlive();
 }
 
 /**
- * @brief Solves the ECDLP for a given point using the Kangaroo method.
+ * @brief Checks if the aggregator found the key.
+ */
+void ShmClientPoll()
+{
+	if ((gShmSlot < 0) || !ShmClientAlive())
+		return;
+	TShmHeader* hdr = (TShmHeader*)gShm.GetData();
+	if (!hdr->solved)
+		return;
+	ShmFence();
+	EcInt pk;
+	pk.Set(0);
+	memcpy(pk.data, hdr->key, 32);
+	printf("Aggregator %s found the key\r\n", gShmClientName);
+	csCollisions.Enter();
+	gTargetKeys[0] = pk;
+	gTargetSolved[0] = true;
+	gSolved = true;
+	csCollisions.Leave();
+}
+
+/**
+ * @brief Attaches to local tames service ("-tames-server") and gets header of its tames file.
  *
- * @param PntToSolve The point to solve.
- * @param Range The range of the search.
- * @param DP The DP value.
- * @param pk_res The resulting private key.
- * @return true If the point is solved.
- * @return false Otherwise.
+ * @param hdr Header of tames file of the service.
+ * @return true If a slot is taken.
  */
+bool TamesClientConnect(TDbFileHeader* hdr)
+{
+	if (!gTamesShm.Open(gTamesServiceName) || (gTamesShm.GetSize() < SHM_TAMES_TOTAL_SIZE))
+	{
+		printf("error: cannot open shared memory %s, start -tames-server first\r\n", gTamesServiceName);
+		gTamesShm.Close();
+		return false;
+	}
+	TShmTamesHeader* shdr = (TShmTamesHeader*)gTamesShm.GetData();
+	if (memcmp(shdr->sign, "RCKTMS", 7) || (shdr->version != SHM_TAMES_VERSION) || (shdr->slot_cnt != SHM_SLOT_CNT) || (shdr->batch != SHM_TAMES_BATCH) ||
+		(GetTickCount64() - shdr->heartbeat > SHM_TIMEOUT))
+	{
+		printf("error: shared memory %s has different version or tames service is not running\r\n", gTamesServiceName);
+		gTamesShm.Close();
+		return false;
+	}
+	TShmTamesSlot* slots = (TShmTamesSlot*)(gTamesShm.GetData() + sizeof(TShmTamesHeader));
+	gTamesSlot = -1;
+	for (int i = 0; i < SHM_SLOT_CNT; i++)
+		if (ShmCas(&slots[i].state, SHM_SLOT_FREE, SHM_SLOT_TAKEN))
+		{
+			gTamesSlot = i;
+			break;
+		}
+	if (gTamesSlot < 0)
+	{
+		printf("error: all %d slots of tames service %s are used\r\n", SHM_SLOT_CNT, gTamesServiceName);
+		gTamesShm.Close();
+		return false;
+	}
+	TShmTamesSlot* slot = &slots[gTamesSlot];
+	slot->pid = ShmGetPid();
+	slot->heartbeat = GetTickCount64();
+	slot->req_seq = 0;
+	slot->ans_seq = 0;
+	gTamesReqSeq = 0;
+	ShmFence();
+	slot->state = SHM_SLOT_ACTIVE;
+	memcpy(hdr, shdr->file_hdr, sizeof(TDbFileHeader));
+	return true;
+}
 
-//bool SolvePoint(EcPoint PntToSolve, int Range, int DP, EcInt* pk_res)
-//{
-//	if ((Range < 19) || (Range > 160))
-//	{
-//		printf("Unsupported Range value (%d)!\r\n", Range);
-//		return false;
-//	}
-//	if ((DP < 4) || (DP > 60)) // Temp Change to Allow for lower DP to build DP model from various runs over bit ranges for DP alorithm
-//	{
-//		printf("Unsupported DP value (%d)!\r\n", DP);
-//		return false;
-//	}
-//
-//	printf("\r\nSolving point: Range %d bits, DP %d, start...\r\n", Range, DP);
-//	double ops = 1.15 * pow(2.0, Range / 2.0);
-//	double dp_val = (double)(1ull << DP);
-//	double ram = (32 + 4 + 4) * ops / dp_val; //+4 for grow allocation and memory fragmentation
-//	ram += sizeof(TListRec) * 256 * 256 * 256; //3byte-prefix table
-//	ram /= (1024 * 1024 * 1024); //GB
-//	printf("SOTA method, estimated ops: 2^%.3f, RAM for DPs: %.3f GB. DP and GPU overheads not included!\r\n", log2(ops), ram);
-//	gIsOpsLimit = false;
-//	double MaxTotalOps = 0.0;
-//	if (gMax > 0)
-//	{
-//		MaxTotalOps = gMax * ops;
-//		double ram_max = (32 + 4 + 4) * MaxTotalOps / dp_val; //+4 for grow allocation and memory fragmentation
-//		ram_max += sizeof(TListRec) * 256 * 256 * 256; //3byte-prefix table
-//		ram_max /= (1024 * 1024 * 1024); //GB
-//		printf("Max allowed number of ops: 2^%.3f, max RAM for DPs: %.3f GB\r\n", log2(MaxTotalOps), ram_max);
-//	}
-//
-//	u64 total_kangs = GpuKangs[0]->CalcKangCnt();
-//	for (int i = 1; i < GpuCnt; i++)
-//		total_kangs += GpuKangs[i]->CalcKangCnt();
-//	double path_single_kang = ops / total_kangs;
-//	double DPs_per_kang = path_single_kang / dp_val;
-//	printf("Estimated DPs per kangaroo: %.3f.%s\r\n", DPs_per_kang, (DPs_per_kang < 4) ? " DP overhead is big, use less DP value if possible!" : "");
-//
-//	if (!gGenMode && gTamesFileName[0])
-//	{
-//		printf("load tames...\r\n");
-//		if (db.LoadFromFile(gTamesFileName))
-//		{
-//			printf("tames loaded\r\n");
-//			if (db.Header[0] != gRange)
-//			{
-//				printf("loaded tames have different range, they cannot be used, clear\r\n");
-//				db.Clear();
-//			}
-//		}
-//		else
-//			printf("tames loading failed\r\n");
-//	}
-//
-//	SetRndSeed(0); //use same seed to make tames from file compatible
-//	PntTotalOps = 0;
-//	PntIndex = 0;
-//	//prepare jumps
-//	EcInt minjump, t;
-//	minjump.Set(1);
-//	minjump.ShiftLeft(Range / 2 + 3);
-//	for (int i = 0; i < JMP_CNT; i++)
-//	{
-//		EcJumps1[i].dist = minjump;
-//		t.RndMax(minjump);
-//		EcJumps1[i].dist.Add(t);
-//		EcJumps1[i].dist.data[0] &= 0xFFFFFFFFFFFFFFFE; //must be even
-//		EcJumps1[i].p = ec.MultiplyG(EcJumps1[i].dist);
-//	}
-//
-//	minjump.Set(1);
-//	minjump.ShiftLeft(Range - 10); //large jumps for L1S2 loops. Must be almost RANGE_BITS
-//	for (int i = 0; i < JMP_CNT; i++)
-//	{
-//		EcJumps2[i].dist = minjump;
-//		t.RndMax(minjump);
-//		EcJumps2[i].dist.Add(t);
-//		EcJumps2[i].dist.data[0] &= 0xFFFFFFFFFFFFFFFE; //must be even
-//		EcJumps2[i].p = ec.MultiplyG(EcJumps2[i].dist);
-//	}
-//
-//	minjump.Set(1);
-//	minjump.ShiftLeft(Range - 10 - 2); //large jumps for loops >2
-//	for (int i = 0; i < JMP_CNT; i++)
-//	{
-//		EcJumps3[i].dist = minjump;
-//		t.RndMax(minjump);
-//		EcJumps3[i].dist.Add(t);
-//		EcJumps3[i].dist.data[0] &= 0xFFFFFFFFFFFFFFFE; //must be even
-//		EcJumps3[i].p = ec.MultiplyG(EcJumps3[i].dist);
-//	}
-//	SetRndSeed(GetTickCount64());
-//
-//	Int_HalfRange.Set(1);
-//	Int_HalfRange.ShiftLeft(Range - 1);
-//	Pnt_HalfRange = ec.MultiplyG(Int_HalfRange);
-//	Pnt_NegHalfRange = Pnt_HalfRange;
-//	Pnt_NegHalfRange.y.NegModP();
-//	Int_TameOffset.Set(1);
-//	Int_TameOffset.ShiftLeft(Range - 1);
-//	EcInt tt;
-//	tt.Set(1);
-//	tt.ShiftLeft(Range - 5); //half of tame range width
-//	Int_TameOffset.Sub(tt);
-//	gPntToSolve = PntToSolve;
-//
-//	//prepare GPUs
-//	for (int i = 0; i < GpuCnt; i++)
-//		if (!GpuKangs[i]->Prepare(PntToSolve, Range, DP, EcJumps1, EcJumps2, EcJumps3))
-//		{
-//			GpuKangs[i]->Failed = true;
-//			printf("GPU %d Prepare failed\r\n", GpuKangs[i]->CudaIndex);
-//		}
-//
-//	u64 tm0 = GetTickCount64();
-//	printf("GPUs started...\r\n");
-//
-//#ifdef _WIN32
-//	HANDLE thr_handles[MAX_GPU_CNT];
-//#else
-//	pthread_t thr_handles[MAX_GPU_CNT];
-//#endif
-//
-//	u32 ThreadID;
-//	gSolved = false;
-//	ThrCnt = GpuCnt;
-//	for (int i = 0; i < GpuCnt; i++)
-//	{
-//#ifdef _WIN32
-//		thr_handles[i] = (HANDLE)_beginthreadex(NULL, 0, kang_thr_proc, (void*)GpuKangs[i], 0, &ThreadID);
-//#else
-//		pthread_create(&thr_handles[i], NULL, kang_thr_proc, (void*)GpuKangs[i]);
-//#endif
-//	}
-//
-//	u64 tm_stats = GetTickCount64();
-//	while (!gSolved)
-//	{
-//		CheckNewPoints();
-//		Sleep(10);
-//		if (GetTickCount64() - tm_stats > 10 * 1000)
-//		{
-//			ShowStats(tm0, ops, dp_val);
-//			tm_stats = GetTickCount64();
-//		}
-//
-//		if ((MaxTotalOps > 0.0) && (PntTotalOps > MaxTotalOps))
-//		{
-//			gIsOpsLimit = true;
-//			printf("Operations limit reached\r\n");
-//			break;
-//		}
-//	}
-//
-//	printf("Stopping work ...\r\n");
-//	for (int i = 0; i < GpuCnt; i++)
-//		GpuKangs[i]->Stop();
-//	while (ThrCnt)
-//		Sleep(10);
-//	for (int i = 0; i < GpuCnt; i++)
+/**
+ * @brief Releases the slot of tames service.
+ */
+void TamesClientClose()
+{
+	if (gTamesSlot < 0)
+		return;
+	TShmTamesSlot* slot = (TShmTamesSlot*)(gTamesShm.GetData() + sizeof(TShmTamesHeader)) + gTamesSlot;
+	if (slot->pid == ShmGetPid()) //slot can be freed by service and taken by other process
+		ShmCas(&slot->state, SHM_SLOT_ACTIVE, SHM_SLOT_CLOSED);
+	gTamesShm.Close();
+	gTamesSlot = -1;
+}
+
+/**
+ * @brief Updates heartbeat of the slot, service frees slots of dead processes.
+ */
+void TamesClientPoll()
+{
+	if (gTamesSlot >= 0)
+		((TShmTamesSlot*)(gTamesShm.GetData() + sizeof(TShmTamesHeader)) + gTamesSlot)->heartbeat = GetTickCount64();
+}
+
+/**
+ * @brief Waits for the answer to the last request and passes found tames to CheckCollision.
+ *
+ * @param use false - answer is dropped, request was made for previous points.
+ */
+void TamesClientWait(bool use)
+{
+	if ((gTamesSlot < 0) || !gTamesReqSeq)
+		return;
+	TShmTamesHeader* shdr = (TShmTamesHeader*)gTamesShm.GetData();
+	TShmTamesSlot* slot = (TShmTamesSlot*)(gTamesShm.GetData() + sizeof(TShmTamesHeader)) + gTamesSlot;
+	while (slot->ans_seq != gTamesReqSeq)
+	{
+		u64 tm = GetTickCount64();
+		if ((slot->state != SHM_SLOT_ACTIVE) || (slot->pid != ShmGetPid()))
+		{
+			//service decided that this process is dead and freed the slot
+			printf("Tames service %s freed the slot of this process, tames are not used\r\n", gTamesServiceName);
+			TamesClientClose();
+			return;
+		}
+		slot->heartbeat = tm;
+		if (tm - shdr->heartbeat > SHM_TIMEOUT)
+		{
+			printf("Tames service %s is not responding, tames are not used\r\n", gTamesServiceName);
+			TamesClientClose();
+			return;
+		}
+		Sleep(0);
+	}
+	ShmFence();
+	slot->heartbeat = GetTickCount64();
+	gTamesReqSeq = 0;
+	if (!use)
+		return;
+	u8* ans = gTamesShm.GetData() + SHM_TAMES_ANS_OFFSET(gTamesSlot);
+	int cnt = slot->ans_cnt;
+	for (int i = 0; i < cnt; i++)
+	{
+		u32 ind = *(u32*)(ans + i * SHM_TAMES_ANS_LEN);
+		if (ind < gTamesReq.size() / DB_FULL_REC_LEN)
+			CheckCollision(gTamesReq.data() + ind * DB_FULL_REC_LEN, ans + i * SHM_TAMES_ANS_LEN + 4, NULL);
+	}
+}
+
+/**
+ * @brief Writes records of gTamesReq to request buffer of the slot.
+ */
+void TamesSendRequest()
+{
+	if ((gTamesSlot < 0) || gTamesReq.empty())
+		return;
+	TShmTamesSlot* slot = (TShmTamesSlot*)(gTamesShm.GetData() + sizeof(TShmTamesHeader)) + gTamesSlot;
+	memcpy(gTamesShm.GetData() + SHM_TAMES_REQ_OFFSET(gTamesSlot), gTamesReq.data(), gTamesReq.size());
+	slot->req_cnt = (u32)(gTamesReq.size() / DB_FULL_REC_LEN);
+	slot->heartbeat = GetTickCount64();
+	ShmFence(); //request must be visible before seq
+	slot->req_seq = slot->ans_seq + 1;
+	gTamesReqSeq = slot->req_seq;
+}
+
+/**
+ * @brief Sends wild DPs to tames service, answer is processed with the next batch so GPUs don't wait for it.
+ *
+ * @param recs DB records, DB_FULL_REC_LEN bytes each.
+ * @param cnt Number of records.
+ */
+void TamesLookup(u8* recs, int cnt)
+{
+	TamesClientWait(true);
+	gTamesReq.resize(0);
+	for (int i = 0; i < cnt; i++)
+	{
+		u8* rec = recs + i * DB_FULL_REC_LEN;
+		if ((rec[DB_FULL_REC_LEN - 1] & KANG_TYPE_MASK) == TAME)
+			continue;
+		if (gTamesReq.size() == SHM_TAMES_BATCH * DB_FULL_REC_LEN)
+		{
+			//request is full, send it and wait for answer
+			TamesSendRequest();
+			TamesClientWait(true);
+			gTamesReq.resize(0);
+		}
+		gTamesReq.insert(gTamesReq.end(), rec, rec + DB_FULL_REC_LEN);
+	}
+	TamesSendRequest();
+}
+
+/**
+ * @brief Checks for new points and processes them.
+ */
+
+void CheckNewPoints()
+{
+	csAddPoints.Enter();
+	if (!PntIndex)
+	{
+		csAddPoints.Leave();
+		return;
+	}
+
+	int cnt = PntIndex;
+	memcpy(pPntList2, pPntList, GPU_DP_SIZE * cnt);
+	PntIndex = 0;
+	csAddPoints.Leave();
+
+	//convert to DBRecs in place, it's safe because DBRec is smaller than GPU DP record
+	//DPs found by GPUs before DP was raised are dropped
+	int new_cnt = 0;
+	for (int i = 0; i < cnt; i++)
+	{
+		DBRec nrec;
+		u8* p = pPntList2 + i * GPU_DP_SIZE;
+		if (*(u32*)(p + 8) & gDPExtMask)
+			continue;
+		memcpy(nrec.x, p, 12);
+		memcpy(nrec.d, p + 16, 22);
+		nrec.type = gGenMode ? TAME : p[40];
+		memcpy(pPntList2 + new_cnt * sizeof(DBRec), &nrec, sizeof(DBRec));
+		new_cnt++;
+	}
+	cnt = new_cnt;
+	if (gServerCnt)
+	{
+		NetSendDPs(pPntList2, cnt); //servers own DB
+		return;
+	}
+	if (gShmClientName[0])
+	{
+		ShmSendDPs(pPntList2, cnt); //local aggregator owns DB
+		return;
+	}
+	gJournal.Add(pPntList2, cnt);
+	if (gTamesSlot >= 0)
+		TamesLookup(pPntList2, cnt);
+	//batch is sorted by X prefix inside so DB is accessed sequentially
+	db.FindOrAddBatch(pPntList2, cnt, gGenMode ? NULL : CheckCollision, NULL);
+}
+
+/**
+// An attempt to reduce the # of calcs performed by CheckNewPoints
+void CheckNewPoints()
+{
+	csAddPoints.Enter();
+	if (!PntIndex)
+	{
+		csAddPoints.Leave();
+		return;
+	}
+
+	int cnt = PntIndex;
+	std::swap(pPntList, pPntList2); // Swap pointers instead of copying memory
+	PntIndex = 0;
+	csAddPoints.Leave();
+
+	for (int i = 0; i < cnt; i++)
+	{
+		DBRec nrec;
+		u8* p = pPntList2 + i * GPU_DP_SIZE;
+		memcpy(nrec.x, p, 12);
+		memcpy(nrec.d, p + 16, 22);
+		nrec.type = gGenMode ? TAME : p[40];
+
+		DBRec* pref = (DBRec*)db.FindOrAddDataBlock((u8*)&nrec);
+		if (gGenMode)
+			continue;
+		if (pref)
+		{
+			//in db we dont store first 3 bytes so restore them
+			DBRec tmp_pref;
+			memcpy(&tmp_pref, &nrec, 3);
+			memcpy(((u8*)&tmp_pref) + 3, pref, sizeof(DBRec) - 3);
+			pref = &tmp_pref;
+
+			if ((pref->type & KANG_TYPE_MASK) == (nrec.type & KANG_TYPE_MASK))
+			{
+				if ((pref->type & KANG_TYPE_MASK) == TAME)
+					continue;
+				if (pref->type != nrec.type)
+					continue;
+
+				//if it's wild, we can find the key from the same type if distances are different
+				if (*(u64*)pref->d == *(u64*)nrec.d)
+					continue;
+			}
+
+			EcInt w, t;
+			int TameType, WildType;
+			if ((pref->type & KANG_TYPE_MASK) != TAME)
+			{
+				memcpy(w.data, pref->d, sizeof(pref->d));
+				if (pref->d[21] == 0xFF) memset(((u8*)w.data) + 22, 0xFF, 18);
+				memcpy(t.data, nrec.d, sizeof(nrec.d));
+				if (nrec.d[21] == 0xFF) memset(((u8*)t.data) + 22, 0xFF, 18);
+				TameType = nrec.type & KANG_TYPE_MASK;
+				WildType = pref->type & KANG_TYPE_MASK;
+			}
+			else
+			{
+				memcpy(w.data, nrec.d, sizeof(nrec.d));
+				if (nrec.d[21] == 0xFF) memset(((u8*)w.data) + 22, 0xFF, 18);
+				memcpy(t.data, pref->d, sizeof(pref->d));
+				if (pref->d[21] == 0xFF) memset(((u8*)t.data) + 22, 0xFF, 18);
+				TameType = TAME;
+				WildType = nrec.type & KANG_TYPE_MASK;
+			}
+
+			bool res = Collision_SOTA(gPntToSolve, t, TameType, w, WildType, false) || Collision_SOTA(gPntToSolve, t, TameType, w, WildType, true);
+			if (!res)
+			{
+				bool w12 = (((pref->type & KANG_TYPE_MASK) == WILD1) && ((nrec.type & KANG_TYPE_MASK) == WILD2)) || (((pref->type & KANG_TYPE_MASK) == WILD2) && ((nrec.type & KANG_TYPE_MASK) == WILD1));
+				if (w12) //in rare cases WILD and WILD2 can collide in mirror, in this case there is no way to find K
+					;// ToLog("W1 and W2 collides in mirror");
+				else
+				{
+					printf("Collision Error\r\n");
+					gTotalErrors++;
+				}
+				continue;
+			}
+			gSolved = true;
+			break;
+		}
+	}
+}
+*/
+
+
+/**
+ * @brief Displays the current statistics of the computation.
+ *
+ * @param tm_start The start time of the computation.
+ * @param exp_ops The expected number of operations.
+ * @param dp_val The DP value.
+ */
+
+void ShowStats(u64 tm_start, double exp_ops, double dp_val)
+{
+#ifdef DEBUG_MODE
+	for (int i = 0; i <= MD_LEN; i++)
+	{
+		u64 val = 0;
+		for (int j = 0; j < GpuCnt; j++)
+		{
+			val += GpuKangs[j]->dbg[i];
+		}
+		if (val)
+			printf("Loop size %d: %llu\r\n", i, val);
+	}
+#endif
+
+	int speed = GpuKangs[0]->GetStatsSpeed();
+	for (int i = 1; i < GpuCnt; i++)
+		speed += GpuKangs[i]->GetStatsSpeed();
+
+	u64 est_dps_cnt = (u64)(exp_ops / dp_val);
+	u64 exp_sec = 0xFFFFFFFFFFFFFFFFull;
+	if (speed)
+		exp_sec = (u64)((exp_ops / 1000000) / speed); //in sec
+	u64 exp_days = exp_sec / (3600 * 24);
+	u64 remaining_exp_sec = exp_sec % (3600 * 24);
+	int exp_hours = static_cast<int>(remaining_exp_sec / 3600);
+	remaining_exp_sec %= 3600;
+	int exp_min = static_cast<int>(remaining_exp_sec / 60);
+	double exp_full_sec = (remaining_exp_sec % 60) + 0.0;  // No fractional seconds for estimated
+
+	u64 elapsed_sec = (GetTickCount64() - tm_start) / 1000;  // Total elapsed seconds
+	u64 elapsed_days = elapsed_sec / (3600 * 24);
+	u64 remaining_elapsed_sec = elapsed_sec % (3600 * 24);
+	int elapsed_hours = static_cast<int>(remaining_elapsed_sec / 3600);
+	remaining_elapsed_sec %= 3600;
+	int elapsed_minutes = static_cast<int>(remaining_elapsed_sec / 60);
+	double elapsed_full_sec = (remaining_elapsed_sec % 60) + ((GetTickCount64() - tm_start) % 1000) / 1000.0;
+
+	TDbStats dbs;
+	db.GetStats(&dbs);
+	printf("%sSpeed: %d MKeys/s, Err: %d, DPs: %lluK/%lluK, DB: %.3f GB, Time: %llud:%02dh:%02dm:%05.2fs/%llud:%02dh:%02dm:%05.2fs\r\n",
+		gGenMode ? "GEN: " : (IsBench ? "BENCH: " : "MAIN: "),
+		speed,
+		gTotalErrors,
+		dbs.RecCnt / 1000,
+		est_dps_cnt / 1000,
+		(double)dbs.TotalBytes / (1024 * 1024 * 1024),
+		elapsed_days, elapsed_hours, elapsed_minutes, elapsed_full_sec,
+		exp_days, exp_hours, exp_min, exp_full_sec);
+	if (gCollisionsChecked)
+		printf("Collisions checked: %u, W1/W2 mirror: %u, false matches: %u\r\n", gCollisionsChecked, gMirrorCollisions, gFalseMatches);
+}
+
+/**
+ * @brief Solves the ECDLP for a given point using the Kangaroo method.
+ *
+ * @param PntToSolve The point to solve.
+ * @param Range The range of the search.
+ * @param DP The DP value.
+ * @param pk_res The resulting private key.
+ * @return true If the point is solved.
+ * @return false Otherwise.
+ */
+
+//bool SolvePoint(EcPoint PntToSolve, int Range, int DP, EcInt* pk_res)
+//{
+//	if ((Range < 19) || (Range > 160))
 //	{
-//#ifdef _WIN32
-//		CloseHandle(thr_handles[i]);
-//#else
-//		pthread_join(thr_handles[i], NULL);
-//#endif
+//		printf("Unsupported Range value (%d)!\r\n", Range);
+//		return false;
 //	}
-//
-//	if (gIsOpsLimit)
+//	if ((DP < 4) || (DP > 60)) // Temp Change to Allow for lower DP to build DP model from various runs over bit ranges for DP alorithm
 //	{
-//		if (gGenMode)
-//		{
-//			printf("saving tames...\r\n");
-//			db.Header[0] = gRange;
-//			if (db.SaveToFile(gTamesFileName))
-//				printf("tames saved\r\n");
-//			else
-//				printf("tames saving failed\r\n");
-//		}
-//		db.Clear();
+//		printf("Unsupported DP value (%d)!\r\n", DP);
 //		return false;
 //	}
 //
-//	double K = (double)PntTotalOps / pow(2.0, Range / 2.0);
-//	printf("Point solved, K: %.3f (with DP and GPU overheads)\r\n\r\n", K);
+//	printf("\r\nSolving point: Range %d bits, DP %d, start...\r\n", Range, DP);
+//	double ops = 1.15 * pow(2.0, Range / 2.0);
+//	double dp_val = (double)(1ull << DP);
+//	double ram = (32 + 4 + 4) * ops / dp_val; //+4 for grow allocation and memory fragmentation
+//	ram += sizeof(TListRec) * 256 * 256 * 256; //3byte-prefix table
+//	ram /= (1024 * 1024 * 1024); //GB
+//	printf("SOTA method, estimated ops: 2^%.3f, RAM for DPs: %.3f GB. DP and GPU overheads not included!\r\n", log2(ops), ram);
+//	gIsOpsLimit = false;
+//	double MaxTotalOps = 0.0;
+//	if (gMax > 0)
+//	{
+//		MaxTotalOps = gMax * ops;
+//		double ram_max = (32 + 4 + 4) * MaxTotalOps / dp_val; //+4 for grow allocation and memory fragmentation
+//		ram_max += sizeof(TListRec) * 256 * 256 * 256; //3byte-prefix table
+//		ram_max /= (1024 * 1024 * 1024); //GB
+//		printf("Max allowed number of ops: 2^%.3f, max RAM for DPs: %.3f GB\r\n", log2(MaxTotalOps), ram_max);
+//	}
+//
+//	u64 total_kangs = GpuKangs[0]->CalcKangCnt();
+//	for (int i = 1; i < GpuCnt; i++)
+//		total_kangs += GpuKangs[i]->CalcKangCnt();
+//	double path_single_kang = ops / total_kangs;
+//	double DPs_per_kang = path_single_kang / dp_val;
+//	printf("Estimated DPs per kangaroo: %.3f.%s\r\n", DPs_per_kang, (DPs_per_kang < 4) ? " DP overhead is big, use less DP value if possible!" : "");
+//
+//	if (!gGenMode && gTamesFileName[0])
+//	{
+//		printf("load tames...\r\n");
+//		if (db.LoadFromFile(gTamesFileName))
+//		{
+//			printf("tames loaded\r\n");
+//			if (db.Header[0] != gRange)
+//			{
+//				printf("loaded tames have different range, they cannot be used, clear\r\n");
+//				db.Clear();
+//			}
+//		}
+//		else
+//			printf("tames loading failed\r\n");
+//	}
+//
+//	SetRndSeed(0); //use same seed to make tames from file compatible
+//	PntTotalOps = 0;
+//	PntIndex = 0;
+//	//prepare jumps
+//	EcInt minjump, t;
+//	minjump.Set(1);
+//	minjump.ShiftLeft(Range / 2 + 3);
+//	for (int i = 0; i < JMP_CNT; i++)
+//	{
+//		EcJumps1[i].dist = minjump;
+//		t.RndMax(minjump);
+//		EcJumps1[i].dist.Add(t);
+//		EcJumps1[i].dist.data[0] &= 0xFFFFFFFFFFFFFFFE; //must be even
+//		EcJumps1[i].p = ec.MultiplyG(EcJumps1[i].dist);
+//	}
+//
+//	minjump.Set(1);
+//	minjump.ShiftLeft(Range - 10); //large jumps for L1S2 loops. Must be almost RANGE_BITS
+//	for (int i = 0; i < JMP_CNT; i++)
+//	{
+//		EcJumps2[i].dist = minjump;
+//		t.RndMax(minjump);
+//		EcJumps2[i].dist.Add(t);
+//		EcJumps2[i].dist.data[0] &= 0xFFFFFFFFFFFFFFFE; //must be even
+//		EcJumps2[i].p = ec.MultiplyG(EcJumps2[i].dist);
+//	}
+//
+//	minjump.Set(1);
+//	minjump.ShiftLeft(Range - 10 - 2); //large jumps for loops >2
+//	for (int i = 0; i < JMP_CNT; i++)
+//	{
+//		EcJumps3[i].dist = minjump;
+//		t.RndMax(minjump);
+//		EcJumps3[i].dist.Add(t);
+//		EcJumps3[i].dist.data[0] &= 0xFFFFFFFFFFFFFFFE; //must be even
+//		EcJumps3[i].p = ec.MultiplyG(EcJumps3[i].dist);
+//	}
+//	SetRndSeed(GetTickCount64());
+//
+//	Int_HalfRange.Set(1);
+//	Int_HalfRange.ShiftLeft(Range - 1);
+//	Pnt_HalfRange = ec.MultiplyG(Int_HalfRange);
+//	Pnt_NegHalfRange = Pnt_HalfRange;
+//	Pnt_NegHalfRange.y.NegModP();
+//	Int_TameOffset.Set(1);
+//	Int_TameOffset.ShiftLeft(Range - 1);
+//	EcInt tt;
+//	tt.Set(1);
+//	tt.ShiftLeft(Range - 5); //half of tame range width
+//	Int_TameOffset.Sub(tt);
+//	gPntToSolve = PntToSolve;
+//
+//	//prepare GPUs
+//	for (int i = 0; i < GpuCnt; i++)
+//		if (!GpuKangs[i]->Prepare(PntToSolve, Range, DP, EcJumps1, EcJumps2, EcJumps3))
+//		{
+//			GpuKangs[i]->Failed = true;
+//			printf("GPU %d Prepare failed\r\n", GpuKangs[i]->CudaIndex);
+//		}
+//
+//	u64 tm0 = GetTickCount64();
+//	printf("GPUs started...\r\n");
+//
+//#ifdef _WIN32
+//	HANDLE thr_handles[MAX_GPU_CNT];
+//#else
+//	pthread_t thr_handles[MAX_GPU_CNT];
+//#endif
+//
+//	u32 ThreadID;
+//	gSolved = false;
+//	ThrCnt = GpuCnt;
+//	for (int i = 0; i < GpuCnt; i++)
+//	{
+//#ifdef _WIN32
+//		thr_handles[i] = (HANDLE)_beginthreadex(NULL, 0, kang_thr_proc, (void*)GpuKangs[i], 0, &ThreadID);
+//#else
+//		pthread_create(&thr_handles[i], NULL, kang_thr_proc, (void*)GpuKangs[i]);
+//#endif
+//	}
+//
+//	u64 tm_stats = GetTickCount64();
+//	while (!gSolved)
+//	{
+//		CheckNewPoints();
+//		Sleep(10);
+//		if (GetTickCount64() - tm_stats > 10 * 1000)
+//		{
+//			ShowStats(tm0, ops, dp_val);
+//			tm_stats = GetTickCount64();
+//		}
+//
+//		if ((MaxTotalOps > 0.0) && (PntTotalOps > MaxTotalOps))
+//		{
+//			gIsOpsLimit = true;
+//			printf("Operations limit reached\r\n");
+//			break;
+//		}
+//	}
+//
+//	printf("Stopping work ...\r\n");
+//	for (int i = 0; i < GpuCnt; i++)
+//		GpuKangs[i]->Stop();
+//	while (ThrCnt)
+//		Sleep(10);
+//	for (int i = 0; i < GpuCnt; i++)
+//	{
+//#ifdef _WIN32
+//		CloseHandle(thr_handles[i]);
+//#else
+//		pthread_join(thr_handles[i], NULL);
+//#endif
+//	}
+//
+//	if (gIsOpsLimit)
+//	{
+//		if (gGenMode)
+//		{
+//			printf("saving tames...\r\n");
+//			db.Header[0] = gRange;
+//			if (db.SaveToFile(gTamesFileName))
+//				printf("tames saved\r\n");
+//			else
+//				printf("tames saving failed\r\n");
+//		}
+//		db.Clear();
+//		return false;
+//	}
+//
+//	double K = (double)PntTotalOps / pow(2.0, Range / 2.0);
+//	printf("Point solved, K: %.3f (with DP and GPU overheads)\r\n\r\n", K);
 //	db.Clear();
 //	*pk_res = gPrivKey;
 //	return true;
@@ -664,320 +1415,2773 @@ void ShowStats(u64 tm_start, double exp_ops, double dp_val)
 
 
 
-// An attempt to reduce the # of calcs performed by SolvePoint
-// Check on whether the SolvePoint function could be optimized by 
-// reducing redundant calculations and improving the efficiency of the loop.
-bool SolvePoint(EcPoint PntToSolve, int Range, int DP, EcInt* pk_res)
+/**
+ * @brief Stops GPU threads and releases GPU memory of the session.
+ */
+void EndSession()
+{
+	if (!gSessionRange)
+		return;
+	gSessionExit = true;
+	for (int i = 0; i < GpuCnt; i++)
+	{
+#ifdef _WIN32
+		WaitForSingleObject(gThrHandles[i], INFINITE);
+		CloseHandle(gThrHandles[i]);
+#else
+		pthread_join(gThrHandles[i], NULL);
+#endif
+		//failed GPU can have a part of buffers allocated
+		GpuKangs[i]->Release();
+	}
+	db.Reset();
+	TamesClientClose();
+	gSessionRange = 0;
+	gSessionDP = 0;
+}
+
+/**
+ * @brief Hash of all jump distances, tames and wilds files are valid only with the same jumps.
+ */
+u64 CalcJumpHash()
+{
+	u64 hash = 0xCBF29CE484222325; //FNV-1a
+	EcJMP* tables[3] = { EcJumps1, EcJumps2, EcJumps3 };
+	for (int t = 0; t < 3; t++)
+		for (int i = 0; i < JMP_CNT; i++)
+		{
+			u8* p = (u8*)tables[t][i].dist.data;
+			for (int j = 0; j < (int)sizeof(tables[t][i].dist.data); j++)
+				hash = (hash ^ p[j]) * 0x100000001B3;
+		}
+	return hash;
+}
+
+/**
+ * @brief Fills header of tames or wilds file for current session, rec_cnt and pnt are set by caller.
+ *
+ * dp_ext_bits keeps DP raised by -ram limit, so the file is loaded with the DP of its records.
+ */
+void MakeDbFileHeader(TDbFileHeader* hdr, int kind, int Range, u64 total_ops)
+{
+	memset(hdr, 0, sizeof(TDbFileHeader));
+	memcpy(hdr->sign, "RCKDBFL", 8);
+	hdr->version = DB_FILE_VERSION;
+	hdr->kind = kind;
+	hdr->range = Range;
+	hdr->dp = gGpuDP;
+	hdr->dp_ext_bits = (u8)__popcnt64(gDPExtMask);
+	hdr->total_ops = total_ops;
+	hdr->jump_seed = gJumpSeed;
+	hdr->jump_hash = gJumpHash;
+	hdr->jmp_cnt = JMP_CNT;
+	hdr->key_len = DB_KEY_LEN;
+	hdr->rec_len = DB_REC_LEN;
+	hdr->x_len = sizeof(((DBRec*)0)->x);
+	hdr->d_len = sizeof(((DBRec*)0)->d);
+	hdr->gpu_cnt = GpuCnt;
+	for (int i = 0; i < GpuCnt; i++)
+		hdr->kang_cnt += GpuKangs[i]->KangCnt;
+}
+
+/**
+ * @brief Checks that header of tames or wilds file can be used in current session.
+ *
+ * Range, jumps and record layout are checked, DP is checked by caller.
+ *
+ * @param fn Name of the file or tames service for messages.
+ * @return true If the tames or wilds can be used.
+ */
+bool CheckDbHeader(char* fn, TDbFileHeader* hdr, int kind, int Range)
+{
+	if (memcmp(hdr->sign, "RCKDBFL", 8))
+	{
+		//old tames file, it was made with jumps seed 0
+		if ((kind != DB_FILE_TAMES) || (hdr->range != Range) || gJumpSeed)
+		{
+			printf("%s: old file without version, made for different range or jumps\r\n", fn);
+			return false;
+		}
+		printf("%s: old tames file without version, DP and jumps are not checked\r\n", fn);
+		hdr->dp = 0;
+		hdr->total_ops = 0;
+		return true;
+	}
+	if ((hdr->version != DB_FILE_VERSION) || (hdr->kind != kind))
+	{
+		printf("%s: unsupported file version %d or wrong file kind\r\n", fn, hdr->version);
+		return false;
+	}
+	if (hdr->range != Range)
+	{
+		printf("%s: file range is %d, current range is %d\r\n", fn, hdr->range, Range);
+		return false;
+	}
+	if ((hdr->jmp_cnt != JMP_CNT) || (hdr->jump_seed != gJumpSeed) || (hdr->jump_hash != gJumpHash))
+	{
+		printf("%s: file was made with different jumps\r\n", fn);
+		return false;
+	}
+	if ((hdr->key_len != DB_KEY_LEN) || (hdr->rec_len != DB_REC_LEN) || (hdr->x_len != sizeof(((DBRec*)0)->x)) || (hdr->d_len != sizeof(((DBRec*)0)->d)))
+	{
+		printf("%s: file has different record layout\r\n", fn);
+		return false;
+	}
+	return true;
+}
+
+/**
+ * @brief Reads only the header of tames or wilds file and checks that the file can be used in current session.
+ *
+ * Range, jumps, record layout and file size are checked, DP is checked by caller.
+ *
+ * @return true If the file can be used.
+ */
+bool CheckDbFileHeader(char* fn, TDbFileHeader* hdr, int kind, int Range)
+{
+	FILE* fp = fopen(fn, "rb");
+	bool ok = fp && (fread(hdr, 1, sizeof(TDbFileHeader), fp) == sizeof(TDbFileHeader));
+	if (fp)
+		fclose(fp);
+	if (!ok)
+	{
+		printf("%s: cannot read file header\r\n", fn);
+		return false;
+	}
+	if (!CheckDbHeader(fn, hdr, kind, Range))
+		return false;
+	if (!memcmp(hdr->sign, "RCKDBFL", 8) && (GetFileLen(fn) != sizeof(TDbFileHeader) + 2ull * 256 * 256 * 256 + hdr->rec_cnt * DB_REC_LEN))
+	{
+		printf("%s: file size doesn't match header, file is truncated or corrupted\r\n", fn);
+		return false;
+	}
+	return true;
+}
+
+/**
+ * @brief Selects DP of GPUs and gTamesExtMask for tames with given header.
+ *
+ * @return false If DP of tames is too low, tames cannot be used.
+ */
+bool SelectTamesDP(TDbFileHeader* hdr)
+{
+	int DP = gSessionDP;
+	if (!hdr->dp)
+		return true;
+	int file_dp = hdr->dp + hdr->dp_ext_bits;
+	if (hdr->dp > DP)
+		printf("tames DP is %d, it's higher than %d, tames are less effective\r\n", file_dp, DP);
+	else
+		if (file_dp > DP)
+		{
+			gGpuDP = hdr->dp;
+			gTamesExtMask = (u32)((1ull << hdr->dp_ext_bits) - 1);
+			printf("tames DP is %d, it's used instead of %d\r\n", file_dp, DP);
+		}
+		else
+			if (DP - hdr->dp > 32)
+			{
+				printf("tames DP %d is too low for DP %d, tames cannot be used\r\n", file_dp, DP);
+				return false;
+			}
+			else
+			{
+				gGpuDP = hdr->dp;
+				gTamesExtMask = (u32)((1ull << (DP - hdr->dp)) - 1);
+				if (file_dp < DP)
+					printf("tames DP is %d, tames that are not DPs for %d are skipped\r\n", file_dp, DP);
+			}
+	return true;
+}
+
+/**
+ * @brief Mask of x[1] bits for "-tames-dp": only tames that are DPs for gTamesDP are loaded.
+ *
+ * Tames DP can be higher than DP of the session, wild DP at the same point is a DP for the session too.
+ *
+ * @return 0 If tames are not filtered.
+ */
+u32 TamesDPMask(TDbFileHeader* hdr)
+{
+	if ((gTamesDP <= hdr->dp + hdr->dp_ext_bits) || (gTamesDP - hdr->dp > 32))
+		return 0;
+	printf("tames DP is %d, tames that are not DPs for %d are skipped (-tames-dp)\r\n", hdr->dp + hdr->dp_ext_bits, gTamesDP);
+	return (u32)((1ull << (gTamesDP - hdr->dp)) - 1);
+}
+
+/**
+ * @brief Attaches to local tames service instead of loading tames file, only wilds are kept in local DB.
+ */
+void LoadTamesService()
+{
+	TDbFileHeader hdr;
+	if (!TamesClientConnect(&hdr))
+	{
+		printf("tames cannot be used\r\n");
+		return;
+	}
+	if (!CheckDbHeader(gTamesServiceName, &hdr, DB_FILE_TAMES, gSessionRange) || !SelectTamesDP(&hdr))
+	{
+		TamesClientClose();
+		gGpuDP = gSessionDP;
+		gTamesExtMask = 0;
+		printf("tames cannot be used\r\n");
+		return;
+	}
+	gTamesOps = hdr.total_ops;
+	printf("tames service %s: %llu DPs, ops: 2^%.3f\r\n", gTamesServiceName, hdr.rec_cnt, log2((double)gTamesOps + 1));
+}
+
+/**
+ * @brief Loads tames file if it's specified, DB must be empty.
+ *
+ * In gen mode tames are loaded only to be extended.
+ * Tames with lower DP are filtered on load: GPUs keep DP of the file and extra bits are checked in x[1] (gTamesExtMask),
+ * so every DP of the session is a DP of the file too.
+ */
+void LoadTames()
+{
+	gTamesOps = 0;
+	gGpuDP = gSessionDP;
+	gTamesExtMask = 0;
+	if (gTamesServiceName[0])
+	{
+		LoadTamesService();
+		return;
+	}
+	if ((gGenMode && !gTamesExtend) || !gTamesFileName[0])
+		return;
+	TDbFileHeader hdr;
+	if (!CheckDbFileHeader(gTamesFileName, &hdr, DB_FILE_TAMES, gSessionRange))
+	{
+		printf("tames cannot be used\r\n");
+		return;
+	}
+	if (!SelectTamesDP(&hdr))
+		return;
+	int DP = gSessionDP;
+	u32 load_mask = gTamesExtMask;
+	if (gTamesDP && !gGenMode && hdr.dp)
+		load_mask |= TamesDPMask(&hdr);
+	printf("load tames...\r\n");
+	if (db.LoadFromFile(gTamesFileName, load_mask))
+	{
+		gTamesOps = hdr.total_ops;
+		printf("tames loaded: %llu DPs, ops: 2^%.3f\r\n", db.GetBlockCnt(), log2((double)gTamesOps + 1));
+	}
+	else
+	{
+		printf("tames loading failed\r\n");
+		db.Reset();
+		gGpuDP = DP;
+		gTamesExtMask = 0;
+	}
+}
+
+/**
+ * @brief Makes jumps for the range from gJumpSeed and calculates gJumpHash.
+ *
+ * @param Range The range of the search.
+ */
+void MakeJumps(int Range)
+{
+	SetRndSeed(gJumpSeed); //use same seed to make tames from file compatible
+	//prepare jumps
+	EcInt minjump, t;
+	minjump.Set(1);
+	minjump.ShiftLeft(Range / 2 + 3);
+	for (int i = 0; i < JMP_CNT; i++)
+	{
+		EcJumps1[i].dist = minjump;
+		t.RndMax(minjump);
+		EcJumps1[i].dist.Add(t);
+		EcJumps1[i].dist.data[0] &= 0xFFFFFFFFFFFFFFFE; //must be even
+		EcJumps1[i].p = ec.MultiplyG(EcJumps1[i].dist);
+	}
+
+	minjump.Set(1);
+	minjump.ShiftLeft(Range - 10); //large jumps for L1S2 loops. Must be almost RANGE_BITS
+	for (int i = 0; i < JMP_CNT; i++)
+	{
+		EcJumps2[i].dist = minjump;
+		t.RndMax(minjump);
+		EcJumps2[i].dist.Add(t);
+		EcJumps2[i].dist.data[0] &= 0xFFFFFFFFFFFFFFFE; //must be even
+		EcJumps2[i].p = ec.MultiplyG(EcJumps2[i].dist);
+	}
+
+	minjump.Set(1);
+	minjump.ShiftLeft(Range - 10 - 2); //large jumps for loops >2
+	for (int i = 0; i < JMP_CNT; i++)
+	{
+		EcJumps3[i].dist = minjump;
+		t.RndMax(minjump);
+		EcJumps3[i].dist.Add(t);
+		EcJumps3[i].dist.data[0] &= 0xFFFFFFFFFFFFFFFE; //must be even
+		EcJumps3[i].p = ec.MultiplyG(EcJumps3[i].dist);
+	}
+	SetRndSeed(GetTickCount64());
+	gJumpHash = CalcJumpHash();
+}
+
+/**
+ * @brief Generates tames on CPU when there are no GPUs, see TamesGenerate.
+ *
+ * Range and DP are the same as for GPU generation, "-tames-extend" file must have the same DP.
+ */
+void RunCpuTamesGen()
+{
+	if (gDpAuto)
+	{
+		printf("error: -dp auto is not supported for tames generation without GPUs\r\n");
+		return;
+	}
+	if (!gRange || !gDP)
+	{
+		printf("error: -range and -dp must be set for tames generation without GPUs\r\n");
+		return;
+	}
+	int Range = gRange;
+	int DP = gDP;
+	printf("\r\nTAMES GENERATION MODE (CPU)\r\n");
+	MakeJumps(Range);
+	gGpuDP = DP;
+	gDPExtMask = 0;
+	if (gTamesExtend)
+	{
+		TDbFileHeader old;
+		if (!CheckDbFileHeader(gTamesFileName, &old, DB_FILE_TAMES, Range))
+			return;
+		if ((old.dp + old.dp_ext_bits != DP) || (old.dp_ext_bits > 32))
+		{
+			printf("error: %s was made with DP %d, use the same -dp to extend it\r\n", gTamesFileName, old.dp + old.dp_ext_bits);
+			return;
+		}
+		gGpuDP = old.dp;
+		gDPExtMask = (u32)((1ull << old.dp_ext_bits) - 1);
+	}
+	TDbFileHeader hdr;
+	MakeDbFileHeader(&hdr, DB_FILE_TAMES, Range, 0);
+	TamesGenerate(gTamesFileName, &hdr, EcJumps1, EcJumps2, EcJumps3, gMax * 1.15 * pow(2.0, Range / 2.0), gTamesExtend);
+}
+
+/**
+ * @brief Prepares jumps, GPUs, GPU threads and loads tames for given range and DP.
+ *
+ * Does nothing if the session is already prepared for these values.
+ *
+ * @param Range The range of the search.
+ * @param DP The DP value.
+ */
+void PrepareSession(int Range, int DP)
+{
+	if ((gSessionRange == Range) && (gSessionDP == DP))
+		return;
+	EndSession();
+	gSessionRange = Range;
+	gSessionDP = DP;
+
+	MakeJumps(Range);
+	LoadTames();
+
+	Int_HalfRange.Set(1);
+	Int_HalfRange.ShiftLeft(Range - 1);
+	Pnt_HalfRange = ec.MultiplyG(Int_HalfRange);
+	Pnt_NegHalfRange = Pnt_HalfRange;
+	Pnt_NegHalfRange.y.NegModP();
+	Int_TameOffset.Set(1);
+	Int_TameOffset.ShiftLeft(Range - 1);
+	EcInt tt;
+	tt.Set(1);
+	tt.ShiftLeft(Range - 5); //half of tame range width
+	Int_TameOffset.Sub(tt);
+
+	//prepare GPUs
+	for (int i = 0; i < GpuCnt; i++)
+		if (!GpuKangs[i]->Prepare(Range, gGpuDP, EcJumps1, EcJumps2, EcJumps3))
+		{
+			GpuKangs[i]->Failed = true;
+			printf("GPU %d Prepare failed\r\n", GpuKangs[i]->CudaIndex);
+		}
+
+	//threads wait for gSessionRun change
+#ifdef _WIN32
+	u32 ThreadID;
+#endif
+	gSessionExit = false;
+	gSessionRun = 0;
+	for (int i = 0; i < GpuCnt; i++)
+	{
+#ifdef _WIN32
+		gThrHandles[i] = (HANDLE)_beginthreadex(NULL, 0, kang_thr_proc, (void*)GpuKangs[i], 0, &ThreadID);
+#else
+		pthread_create(&gThrHandles[i], NULL, kang_thr_proc, (void*)GpuKangs[i]);
+#endif
+	}
+}
+
+/**
+ * @brief Removes DPs of solved points so the session can take next ones.
+ *
+ * Wild DPs depend on the point and are removed, tame DPs are valid for any point of the same range and are kept.
+ * Benchmark mode drops tames too (and reloads tames file) so K of every point is measured from the same start.
+ */
+void EndPoint()
+{
+	if (!IsBench)
+	{
+		bool remove[256];
+		for (int i = 0; i < 256; i++)
+			remove[i] = (i & KANG_TYPE_MASK) != TAME;
+		db.RemoveTypes(remove);
+		return;
+	}
+	db.Reset();
+	LoadTames();
+}
+
+/**
+ * @brief Saves wild DPs of unsolved point, so next attempt continues with them.
+ *
+ * @param Pnt The point to solve.
+ * @param Range The range of the search.
+ */
+void SaveWilds(EcPoint& Pnt, int Range)
+{
+	bool types[256];
+	memset(types, 0, sizeof(types));
+	types[WILD1] = true;
+	types[WILD2] = true;
+	TDbStats dbs;
+	db.GetStats(&dbs);
+	u8 tames_hdr[sizeof(db.Header)];
+	memcpy(tames_hdr, db.Header, sizeof(db.Header));
+	TDbFileHeader* hdr = (TDbFileHeader*)db.Header;
+	MakeDbFileHeader(hdr, DB_FILE_WILDS, Range, gWildsOps + PntTotalOps);
+	Pnt.SaveToBuffer64(hdr->pnt);
+	hdr->rec_cnt = dbs.TypeCnt[WILD1] + dbs.TypeCnt[WILD2];
+	printf("saving wilds...\r\n");
+	if (db.SaveToFile(gWildsFileName, types))
+		printf("wilds saved: %llu DPs, ops of all attempts: 2^%.3f\r\n", hdr->rec_cnt, log2((double)(gWildsOps + PntTotalOps)));
+	else
+		printf("wilds saving failed\r\n");
+	memcpy(db.Header, tames_hdr, sizeof(db.Header));
+}
+
+/**
+ * @brief Loads wild DPs of previous attempts for the same point, range, jumps and DP.
+ *
+ * @param Pnt The point to solve.
+ * @param Range The range of the search.
+ */
+void LoadWilds(EcPoint& Pnt, int Range)
+{
+	gWildsOps = 0;
+	if (!IsFileExist(gWildsFileName))
+		return;
+	TDbFileHeader hdr;
+	u8 pnt[64];
+	Pnt.SaveToBuffer64(pnt);
+	if (!CheckDbFileHeader(gWildsFileName, &hdr, DB_FILE_WILDS, Range) || (hdr.dp != gGpuDP) || memcmp(hdr.pnt, pnt, 64))
+	{
+		printf("wilds file was saved for different point, range, jumps or DP, it's not used\r\n");
+		return;
+	}
+	printf("load wilds...\r\n");
+	u64 cnt = db.GetBlockCnt();
+	if (!db.MergeFromFile(gWildsFileName, (u8*)&hdr, CheckCollision, NULL))
+	{
+		printf("wilds loading failed\r\n");
+		return;
+	}
+	gWildsOps = hdr.total_ops;
+	printf("wilds loaded: %llu DPs, ops of previous attempts: 2^%.3f\r\n", db.GetBlockCnt() - cnt, log2((double)gWildsOps + 1));
+}
+
+/**
+ * @brief Makes header of DP journal, journal of other point or run cannot be replayed.
+ */
+void MakeJournalHeader(TJournalHeader* hdr, EcPoint& Pnt, int Range, int DP, u64 run_id)
+{
+	memset(hdr, 0, sizeof(TJournalHeader));
+	memcpy(hdr->sign, "RCKJRNL", 8);
+	hdr->version = JOURNAL_VERSION;
+	hdr->range = Range;
+	hdr->dp = DP;
+	Pnt.SaveToBuffer64(hdr->pnt);
+	hdr->run_id = run_id;
+}
+
+/**
+ * @brief Saves checkpoint: DB (tames and wilds), ops counter, jumps seed and kangaroos of every GPU.
+ *
+ * GPUs are paused after their current iteration, so kangaroos and DB match. File is written to a temp file and renamed.
+ * GPU that is not running (failed or stopped) has no valid kangaroos, zero count is saved for it and it starts new kangaroos on resume.
+ * If DP journal is enabled, DB is not written, journal is synced and its length is saved instead.
+ *
+ * @param Pnt The point to solve.
+ * @param Range The range of the search.
+ * @param DP The DP value.
+ * @return true If checkpoint is saved.
+ */
+bool SaveCheckpoint(EcPoint& Pnt, int Range, int DP)
+{
+	u64 tm = GetTickCount64();
+	for (int i = 0; i < GpuCnt; i++)
+		GpuKangs[i]->Pause();
+	bool paused[MAX_GPU_CNT];
+	for (int i = 0; i < GpuCnt; i++)
+		paused[i] = GpuKangs[i]->WaitPaused();
+	CheckNewPoints();
+
+	char tmp_name[1100];
+	sprintf(tmp_name, "%s.tmp", gCheckpointFileName);
+	bool res = false;
+	FILE* fp = fopen(tmp_name, "wb");
+	if (fp)
+	{
+		TCheckpointHeader hdr;
+		memset(&hdr, 0, sizeof(hdr));
+		memcpy(hdr.sign, "RCKCHKP", 8);
+		hdr.version = CHECKPOINT_VERSION;
+		hdr.range = Range;
+		hdr.dp = DP;
+		hdr.dp_ext_mask = gDPExtMask;
+		hdr.jump_seed = gJumpSeed;
+		hdr.total_ops = PntTotalOps;
+		Pnt.SaveToBuffer64(hdr.pnt);
+		hdr.gpu_cnt = GpuCnt;
+		if (gJournal.IsOpen())
+		{
+			hdr.run_id = gRunId;
+			hdr.journal_len = gJournal.Flush();
+		}
+		else
+			hdr.flags = CHECKPOINT_FLAG_DB;
+		res = (fwrite(&hdr, 1, sizeof(hdr), fp) == sizeof(hdr));
+		for (int i = 0; res && (i < GpuCnt); i++)
+		{
+			//GPU that failed or stopped has no valid kangs, zero count is saved and it starts new kangs on resume
+			u32 kang_cnt = paused[i] ? GpuKangs[i]->KangCnt : 0;
+			if (!paused[i])
+				printf("WARNING: GPU %d is not running, its kangaroos are not saved in checkpoint\r\n", GpuKangs[i]->CudaIndex);
+			res = (fwrite(&kang_cnt, 1, 4, fp) == 4) && (!kang_cnt || (fwrite(GpuKangs[i]->GetKangs(), 96, kang_cnt, fp) == kang_cnt));
+		}
+		db.Header[0] = Range;
+		if (hdr.flags & CHECKPOINT_FLAG_DB)
+			res = res && db.SaveToStream(fp);
+		if (fclose(fp))
+			res = false;
+	}
+	for (int i = 0; i < GpuCnt; i++)
+		GpuKangs[i]->Resume();
+	if (res)
+	{
+#ifdef _WIN32
+		remove(gCheckpointFileName);
+#endif
+		res = !rename(tmp_name, gCheckpointFileName);
+	}
+	if (res)
+		printf("Checkpoint saved: %llu DPs, %llu ms\r\n", db.GetBlockCnt(), GetTickCount64() - tm);
+	else
+		printf("WARNING: Cannot save checkpoint to %s!\r\n", gCheckpointFileName);
+	return res;
+}
+
+/**
+ * @brief Loads checkpoint saved by SaveCheckpoint, GPUs continue saved kangaroos on next start.
+ *
+ * Checkpoint must be made for the same point, range, DP and GPUs.
+ *
+ * @param Pnt The point to solve.
+ * @param Range The range of the search.
+ * @param DP The DP value.
+ * @return true If checkpoint is loaded.
+ */
+bool LoadCheckpoint(EcPoint& Pnt, int Range, int DP)
+{
+	FILE* fp = fopen(gCheckpointFileName, "rb");
+	if (!fp)
+	{
+		printf("error: cannot open checkpoint file %s\r\n", gCheckpointFileName);
+		return false;
+	}
+	TCheckpointHeader hdr;
+	u8 pnt[64];
+	Pnt.SaveToBuffer64(pnt);
+	if ((fread(&hdr, 1, sizeof(hdr), fp) != sizeof(hdr)) || memcmp(hdr.sign, "RCKCHKP", 8) || (hdr.version != CHECKPOINT_VERSION))
+	{
+		printf("error: %s is not a checkpoint file\r\n", gCheckpointFileName);
+		fclose(fp);
+		return false;
+	}
+	if ((hdr.range != (u32)Range) || (hdr.dp != (u32)DP) || memcmp(hdr.pnt, pnt, 64) || (hdr.gpu_cnt != (u32)GpuCnt))
+	{
+		printf("error: checkpoint was made for different point, range, DP or GPUs\r\n");
+		fclose(fp);
+		return false;
+	}
+	if (hdr.jump_seed != gJumpSeed)
+	{
+		gJumpSeed = hdr.jump_seed;
+		EndSession();
+		PrepareSession(Range, DP);
+	}
+	bool res = true;
+	for (int i = 0; res && (i < GpuCnt); i++)
+	{
+		u32 kang_cnt;
+		res = (fread(&kang_cnt, 1, 4, fp) == 4) && (!kang_cnt || (kang_cnt == (u32)GpuKangs[i]->KangCnt));
+		if (!res)
+			break;
+		if (!kang_cnt)
+		{
+			printf("GPU %d: kangaroos were not saved in checkpoint, new kangaroos are used\r\n", GpuKangs[i]->CudaIndex);
+			continue;
+		}
+		u8* buf = (u8*)malloc((u64)kang_cnt * 96);
+		res = (fread(buf, 96, kang_cnt, fp) == kang_cnt);
+		if (res)
+			GpuKangs[i]->SetResumeKangs(buf);
+		free(buf);
+	}
+	if (hdr.flags & CHECKPOINT_FLAG_DB)
+		res = res && db.LoadFromStream(fp);
+	fclose(fp);
+	if (!res)
+	{
+		printf("error: checkpoint file %s is corrupted or was made for different GPUs\r\n", gCheckpointFileName);
+		db.Reset();
+		return false;
+	}
+	if (hdr.flags & CHECKPOINT_FLAG_DB)
+	{
+		if (gJournalSync > 0)
+		{
+			printf("error: checkpoint was saved without -journal option, resume it without -journal\r\n");
+			return false;
+		}
+	}
+	else
+	{
+		//DB is tames (already loaded) + journal
+		if (gJournalSync <= 0)
+			gJournalSync = 5;
+		char jname[1100];
+		sprintf(jname, "%s.journal", gCheckpointFileName);
+		TJournalHeader jhdr;
+		MakeJournalHeader(&jhdr, Pnt, Range, DP, hdr.run_id);
+		u64 tm = GetTickCount64();
+		u64 valid_len, rec_cnt;
+		//DPs are journaled before they are checked for collisions, so replayed records are checked again
+		if (!DPJournal::Replay(jname, (u8*)&jhdr, &db, CheckCollision, NULL, &valid_len, &rec_cnt) || (valid_len < hdr.journal_len))
+		{
+			printf("error: DP journal %s is missing, corrupted or doesn't match checkpoint\r\n", jname);
+			db.Reset();
+			return false;
+		}
+		if (hdr.dp_ext_mask)
+			db.RemoveByMask(hdr.dp_ext_mask);
+		printf("DP journal replayed: %llu records, %llu ms\r\n", rec_cnt, GetTickCount64() - tm);
+		gRunId = hdr.run_id;
+		if (!gJournal.Append(jname, (u8*)&jhdr, valid_len, (u64)(gJournalSync * 1000)))
+		{
+			printf("error: cannot open DP journal %s\r\n", jname);
+			return false;
+		}
+	}
+	PntTotalOps = hdr.total_ops;
+	gDPExtMask = hdr.dp_ext_mask;
+	for (int i = 0; i < GpuCnt; i++)
+		GpuKangs[i]->SetDPExtMask(gDPExtMask);
+	printf("Checkpoint loaded: %llu DPs, ops: 2^%.3f\r\n", db.GetBlockCnt(), log2((double)PntTotalOps + 1));
+	return true;
+}
+
+/**
+ * @brief Raises DP value by one bit when DB memory gets close to -ram limit.
+ *
+ * A DP for the higher value is also a DP for the current one, so DB keeps records that match the new value and GPUs get the new mask.
+ * Extra DP bits are taken from x[1] because DB stores only first 12 bytes of X.
+ *
+ * @param DP DP bits of x[3] used by GPUs in the session.
+ */
+void CheckDbMemory(int DP)
+{
+	if (gRamLimit <= 0)
+		return;
+	TDbStats dbs;
+	db.GetStats(&dbs);
+	double limit = gRamLimit * (1024 * 1024 * 1024);
+	if (dbs.PoolBytes + dbs.ListBytes + dbs.IndexBytes < DP_RAISE_LEVEL * limit)
+		return;
+	int ext_bits = (int)__popcnt64(gDPExtMask);
+	if ((ext_bits >= 32) || (DP + ext_bits >= 60))
+		return;
+	gDPExtMask = (gDPExtMask << 1) | 1;
+	for (int i = 0; i < GpuCnt; i++)
+		GpuKangs[i]->SetDPExtMask(gDPExtMask);
+	u64 tm = GetTickCount64();
+	u64 removed = db.RemoveByMask(gDPExtMask);
+	u64 old_bytes = dbs.PoolBytes + dbs.ListBytes + dbs.IndexBytes;
+	db.GetStats(&dbs);
+	printf("DB memory %.3f GB of %.1f GB limit: DP raised to %d, %llu records removed, %llu left, DB memory %.3f GB, %llu ms\r\n",
+		old_bytes / (1024.0 * 1024 * 1024), gRamLimit, DP + ext_bits + 1, removed, dbs.RecCnt,
+		(dbs.PoolBytes + dbs.ListBytes + dbs.IndexBytes) / (1024.0 * 1024 * 1024), GetTickCount64() - tm);
+}
+
+/**
+ * @brief Selects the lowest DP value that keeps DB in -ram limit, used for "-dp auto".
+ *
+ * DB size is estimated from the measured memory per record, lower DP always gives less DP overhead.
+ * DP is bounded below by GPU DP buffer size and above by DP_AUTO_MAX_OVERHEAD.
+ *
+ * @param Range The range of the search.
+ * @return int The DP value, 0 if no DP value meets all limits.
+ */
+int AutoSelectDP(int Range)
+{
+	static int last_range = 0;
+	static int last_dp = 0;
+	if (Range == last_range)
+		return last_dp;
+	double ops = 1.15 * pow(2.0, Range / 2.0);
+	double max_ops = (gMax > 0) ? gMax * ops : DP_AUTO_OPS_MARGIN * ops;
+	double limit = gRamLimit * (1024 * 1024 * 1024) - gDbFixedBytes;
+	u64 total_kangs = 0;
+	u64 max_kangs = 0;
+	for (int i = 0; i < GpuCnt; i++)
+	{
+		u64 kangs = GpuKangs[i]->CalcKangCnt();
+		total_kangs += kangs;
+		max_kangs = (kangs > max_kangs) ? kangs : max_kangs;
+	}
+	//lower bound: DPs of one iteration must fit GPU DP buffer, else points are lost
+	int dp_min = 4;
+	while ((dp_min < 60) && ((double)max_kangs * STEP_CNT / pow(2.0, dp_min) > DP_AUTO_MAX_DP_FILL * MAX_DP_CNT))
+		dp_min++;
+	//upper bound: DP overhead
+	int dp_max = dp_min - 1;
+	while ((dp_max < 60) && (total_kangs * pow(2.0, dp_max + 1) / ops <= DP_AUTO_MAX_OVERHEAD))
+		dp_max++;
+	if (dp_max < dp_min)
+	{
+		printf("error: no DP value for range %d: DP %d is required by GPU DP buffer, but DP overhead is above %.0f%% at it, range is too small for this number of kangaroos\r\n",
+			Range, dp_min, 100.0 * DP_AUTO_MAX_OVERHEAD);
+		return 0;
+	}
+	int DP = 0;
+	for (int dp = dp_min; dp <= dp_max; dp++)
+		if (max_ops / pow(2.0, dp) * gDbRecCost <= limit)
+		{
+			DP = dp;
+			break;
+		}
+	if (!DP)
+	{
+		printf("error: DB for range %d doesn't fit %.1f GB RAM at any DP value from %d to %d (DP overhead up to %.0f%%), more RAM is required for this number of kangaroos\r\n",
+			Range, gRamLimit, dp_min, dp_max, 100.0 * DP_AUTO_MAX_OVERHEAD);
+		return 0;
+	}
+	double ram = (max_ops / pow(2.0, DP) * gDbRecCost + gDbFixedBytes) / (1024 * 1024 * 1024);
+	double overhead = total_kangs * pow(2.0, DP) / ops;
+	printf("Auto DP for range %d: %d, RAM for DPs up to %.3f GB of %.1f GB, DP overhead %.1f%%\r\n", Range, DP, ram, gRamLimit, 100.0 * overhead);
+	last_range = Range;
+	last_dp = DP;
+	return DP;
+}
+
+/**
+ * @brief Solves several points of the same range at once.
+ *
+ * Tame kangaroos and tame DPs are shared, every unsolved point gets its own group of wild kangaroos.
+ * When some points are solved, their wild DPs are removed and their wild kangaroos are given to the remaining points.
+ *
+ * @param Pnts The points to solve, up to MAX_TARGET_CNT.
+ * @param cnt Number of points.
+ * @param Range The range of the search.
+ * @param DP The DP value.
+ * @param pk_res The resulting private keys.
+ * @param solved Receives solved flag for every point.
+ * @return int Number of solved points, -1 if parameters are invalid.
+ */
+
+// An attempt to reduce the # of calcs performed by SolvePoint
+// Check on whether the SolvePoint function could be optimized by 
+// reducing redundant calculations and improving the efficiency of the loop.
+int SolvePoints(EcPoint* Pnts, int cnt, int Range, int DP, EcInt* pk_res, bool* solved)
+{
+	if (!DP && gDpAuto && (Range >= 19) && (Range <= 160))
+		DP = AutoSelectDP(Range);
+	if ((Range < 19) || (Range > 160))
+	{
+		printf("Unsupported Range value (%d)!\r\n", Range);
+		return -1;
+	}
+	if ((DP < 4) || (DP > 60)) // Temp Change to Allow for lower DP to build DP model from various runs over bit ranges for DP alorithm
+	{
+		printf("Unsupported DP value (%d)!\r\n", DP);
+		return -1;
+	}
+	if ((cnt < 1) || (cnt > MAX_TARGET_CNT))
+	{
+		printf("Unsupported number of points (%d)!\r\n", cnt);
+		return -1;
+	}
+
+	if (cnt > 1)
+		printf("\r\nSolving %d points: Range %d bits, DP %d, start...\r\n", cnt, Range, DP);
+	else
+		printf("\r\nSolving point: Range %d bits, DP %d, start...\r\n", Range, DP);
+	double ops = 1.15 * pow(2.0, Range / 2.0);
+	double dp_val = (double)(1ull << DP);
+	double ram = (32 + 4 + 4) * ops / dp_val; //+4 for grow allocation and memory fragmentation
+	ram += sizeof(TListRec) * 256 * 256 * 256; //3byte-prefix table
+	ram /= (1024 * 1024 * 1024); //GB
+	printf("SOTA method, estimated ops: 2^%.3f, RAM for DPs: %.3f GB. DP and GPU overheads not included!\r\n", log2(ops), ram);
+	gIsOpsLimit = false;
+	double MaxTotalOps = 0.0;
+	if (gMax > 0)
+	{
+		MaxTotalOps = gMax * ops;
+		double ram_max = (32 + 4 + 4) * MaxTotalOps / dp_val; //+4 for grow allocation and memory fragmentation
+		ram_max += sizeof(TListRec) * 256 * 256 * 256; //3byte-prefix table
+		ram_max /= (1024 * 1024 * 1024); //GB
+		printf("Max allowed number of ops: 2^%.3f, max RAM for DPs: %.3f GB\r\n", log2(MaxTotalOps), ram_max);
+	}
+
+	u64 total_kangs = GpuKangs[0]->CalcKangCnt();
+	for (int i = 1; i < GpuCnt; i++)
+		total_kangs += GpuKangs[i]->CalcKangCnt();
+	double path_single_kang = ops / total_kangs;
+	double DPs_per_kang = path_single_kang / dp_val;
+	printf("Estimated DPs per kangaroo: %.3f.%s\r\n", DPs_per_kang, (DPs_per_kang < 5) ? " DP overhead is big, use less DP value if possible!" : "");
+
+	PrepareSession(Range, DP);
+	PntTotalOps = 0;
+	gDPExtMask = gTamesExtMask;
+	for (int i = 0; i < GpuCnt; i++)
+		GpuKangs[i]->SetDPExtMask(gDPExtMask);
+	//collisions of replayed journal and loaded wilds are queued and verified when collision thread starts
+	CollisionList.clear();
+	if (gResume)
+	{
+		gResume = false; //only the first point continues from checkpoint
+		if (!LoadCheckpoint(Pnts[0], Range, DP))
+			return -1;
+	}
+	if (gServerCnt && !NetClientIsConnected() && !NetClientConnect(Pnts[0], Range, DP))
+		return -1;
+	if (gShmClientName[0] && (gShmSlot < 0) && !ShmClientConnect(Pnts[0], Range, DP))
+		return -1;
+	TamesClientWait(false); //answer for DPs of previous points
+	if ((gJournalSync > 0) && !gJournal.IsOpen())
+	{
+		char jname[1100];
+		sprintf(jname, "%s.journal", gCheckpointFileName);
+		EcInt id;
+		id.RndBits(64);
+		gRunId = id.data[0];
+		TJournalHeader jhdr;
+		MakeJournalHeader(&jhdr, Pnts[0], Range, DP, gRunId);
+		if (!gJournal.Create(jname, (u8*)&jhdr, (u64)(gJournalSync * 1000)))
+		{
+			printf("error: cannot create DP journal %s\r\n", jname);
+			return -1;
+		}
+	}
+	gTargetCnt = cnt;
+	for (int i = 0; i < cnt; i++)
+	{
+		gTargets[i] = Pnts[i];
+		gTargetSolved[i] = false;
+		solved[i] = false;
+	}
+	if (gWildsFileName[0])
+		LoadWilds(Pnts[0], Range);
+	int solved_cnt = 0;
+	bool keep_kangs = false;
+	//target slots stay the same for all runs so kangs continue after a point is solved:
+	//wild slots of solved points get unsolved points and are restarted, tames and other wilds keep walking
+	u8 ids[MAX_TARGET_CNT];
+	for (int i = 0; i < cnt; i++)
+		ids[i] = i;
+	int next = 0;
+	u64 tm0 = GetTickCount64();
+	while (solved_cnt < cnt)
+	{
+		EcPoint pnts[MAX_TARGET_CNT];
+		for (int i = 0; i < cnt; i++)
+		{
+			if (solved[ids[i]])
+			{
+				while (solved[next % cnt])
+					next++;
+				ids[i] = next % cnt;
+				next++;
+			}
+			pnts[i] = gTargets[ids[i]];
+		}
+		for (int i = 0; i < GpuCnt; i++)
+			GpuKangs[i]->SetTargets(pnts, ids, cnt, keep_kangs);
+		keep_kangs = true;
+		PntIndex = 0;
+		printf("GPUs started...\r\n");
+
+#ifdef _WIN32
+		u32 ThreadID;
+#endif
+		gSolved = false;
+		gCollisionThrStop = false;
+#ifdef _WIN32
+		HANDLE coll_thr_handle = (HANDLE)_beginthreadex(NULL, 0, collision_thr_proc, NULL, 0, &ThreadID);
+#else
+		pthread_t coll_thr_handle;
+		pthread_create(&coll_thr_handle, NULL, collision_thr_proc, NULL);
+#endif
+		ThrCnt = GpuCnt;
+		gSessionRun++; //wake up GPU threads
+
+		u64 tm_stats = GetTickCount64();
+		u64 tm_checkpoint = GetTickCount64();
+		while (!gSolved)
+		{
+			CheckNewPoints();
+			CheckDbMemory(gGpuDP);
+			if (gServerCnt)
+			{
+				NetClientPoll();
+				if (!NetClientIsConnected())
+				{
+					gIsOpsLimit = true; //stop without result like ops limit
+					break;
+				}
+			}
+			TamesClientPoll();
+			if (gShmClientName[0])
+			{
+				ShmClientPoll();
+				if (gShmSlot < 0)
+				{
+					gIsOpsLimit = true;
+					break;
+				}
+			}
+			Sleep(10);
+			if (GetTickCount64() - tm_stats > 10 * 1000)
+			{
+				ShowStats(tm0, ops, dp_val);
+				tm_stats = GetTickCount64();
+			}
+			if (gCheckpointFileName[0] && (GetTickCount64() - tm_checkpoint > gCheckpointInterval * 60 * 1000))
+			{
+				SaveCheckpoint(Pnts[0], Range, DP);
+				tm_checkpoint = GetTickCount64();
+			}
+
+			if ((MaxTotalOps > 0.0) && (PntTotalOps > MaxTotalOps))
+			{
+				gIsOpsLimit = true;
+				printf("Operations limit reached\r\n");
+				if (gCheckpointFileName[0])
+					SaveCheckpoint(Pnts[0], Range, DP); //run can be continued with bigger -max
+				break;
+			}
+		}
+
+		printf("Stopping work ...\r\n");
+		for (int i = 0; i < GpuCnt; i++)
+			GpuKangs[i]->Stop();
+		while (ThrCnt)
+			Sleep(10);
+		if (cnt > 1)
+			CheckNewPoints(); //last DPs of unsolved points must not be lost
+		//verify candidates that are still in the queue, one of them can solve the point
+		gCollisionThrStop = true;
+#ifdef _WIN32
+		WaitForSingleObject(coll_thr_handle, INFINITE);
+		CloseHandle(coll_thr_handle);
+#else
+		pthread_join(coll_thr_handle, NULL);
+#endif
+
+		//wild DPs of solved points are useless now
+		bool remove[256];
+		memset(remove, 0, sizeof(remove));
+		for (int i = 0; i < cnt; i++)
+			if (gTargetSolved[i] && !solved[i])
+			{
+				solved[i] = true;
+				pk_res[i] = gTargetKeys[i];
+				remove[WILD1 | (i << TARGET_SHIFT)] = true;
+				remove[WILD2 | (i << TARGET_SHIFT)] = true;
+				solved_cnt++;
+				if (cnt > 1)
+					printf("Point %d solved, %d left\r\n", i, cnt - solved_cnt);
+			}
+		if (gIsOpsLimit)
+			break;
+		if (solved_cnt < cnt)
+			db.RemoveTypes(remove);
+	}
+
+	gJournal.Close();
+
+	if (gIsOpsLimit && (solved_cnt < cnt))
+	{
+		if (gGenMode)
+		{
+			printf("saving tames...\r\n");
+			TDbFileHeader* hdr = (TDbFileHeader*)db.Header;
+			MakeDbFileHeader(hdr, DB_FILE_TAMES, Range, gTamesOps + PntTotalOps);
+			hdr->rec_cnt = db.GetBlockCnt();
+			if (db.SaveToFile(gTamesFileName))
+				printf("tames saved: %llu DPs, DP %d, ops: 2^%.3f\r\n", db.GetBlockCnt(), hdr->dp + hdr->dp_ext_bits, log2((double)(gTamesOps + PntTotalOps)));
+			else
+				printf("tames saving failed\r\n");
+		}
+		else
+			if (gWildsFileName[0])
+				SaveWilds(Pnts[0], Range);
+		db.GetStats(&gLastDbStats);
+		EndPoint();
+		return solved_cnt;
+	}
+
+	double K = (double)PntTotalOps / pow(2.0, Range / 2.0);
+	if (cnt > 1)
+		printf("Points solved: %d, K per point: %.3f (with DP and GPU overheads)\r\n\r\n", cnt, K / cnt);
+	else
+		printf("Point solved, K: %.3f (with DP and GPU overheads)\r\n\r\n", K);
+	db.GetStats(&gLastDbStats);
+	EndPoint();
+	return solved_cnt;
+}
+
+/**
+ * @brief Solves the ECDLP for a given point using the Kangaroo method.
+ *
+ * @param PntToSolve The point to solve.
+ * @param Range The range of the search.
+ * @param DP The DP value.
+ * @param pk_res The resulting private key.
+ * @return true If the point is solved.
+ * @return false Otherwise.
+ */
+bool SolvePoint(EcPoint PntToSolve, int Range, int DP, EcInt* pk_res)
+{
+	bool solved;
+	return SolvePoints(&PntToSolve, 1, Range, DP, pk_res, &solved) == 1;
+}
+
+/**
+ * @brief Parses the command line arguments.
+ *
+ * @param argc The number of arguments.
+ * @param argv The argument values.
+ * @return true If the arguments are valid.
+ * @return false Otherwise.
+ */
+
+bool ParseCommandLine(int argc, char* argv[])
+{
+	int ci = 1;
+	while (ci < argc)
+	{
+		char* argument = argv[ci];
+		ci++;
+		if (strcmp(argument, "-gpu") == 0)
+		{
+			if (ci >= argc)
+			{
+				printf("error: missed value after -gpu option\r\n");
+				return false;
+			}
+			char* gpus = argv[ci];
+			ci++;
+			memset(gGPUs_Mask, 0, sizeof(gGPUs_Mask));
+			for (int i = 0; i < (int)strlen(gpus); i++)
+			{
+				if ((gpus[i] < '0') || (gpus[i] > '9'))
+				{
+					printf("error: invalid value for -gpu option\r\n");
+					return false;
+				}
+				gGPUs_Mask[gpus[i] - '0'] = 1;
+			}
+		}
+		else
+			if (strcmp(argument, "-dp") == 0)
+			{
+				if (strcmp(argv[ci], "auto") == 0)
+				{
+					ci++;
+					gDpAuto = true;
+				}
+				else
+				{
+					int val = atoi(argv[ci]);
+					ci++;
+					if ((val < 4) || (val > 60)) // Temp Change to Allow for lower DP to build DP model from various runs over bit ranges for DP alorithm
+					{
+						printf("error: invalid value for -dp option\r\n");
+						return false;
+					}
+					gDP = val;
+				}
+			}
+			else
+				if (strcmp(argument, "-range") == 0)
+				{
+					int val = atoi(argv[ci]);
+					ci++;
+					if ((val < 19) || (val > 160))
+					{
+						printf("error: invalid value for -range option\r\n");
+						return false;
+					}
+					gRange = val;
+				}
+				else
+					if (strcmp(argument, "-start") == 0)
+					{
+						if (!gStart.SetHexStr(argv[ci]))
+						{
+							printf("error: invalid value for -start option\r\n");
+							return false;
+						}
+						ci++;
+						gStartSet = true;
+					}
+					else
+						if (strcmp(argument, "-pubkey") == 0)
+						{
+							if (!gPubKey.SetHexStr(argv[ci]))
+							{
+								printf("error: invalid value for -pubkey option\r\n");
+								return false;
+							}
+							ci++;
+						}
+						else
+							if (strcmp(argument, "-tames") == 0)
+							{
+								strcpy(gTamesFileName, argv[ci]);
+								ci++;
+							}
+							else
+								if (strcmp(argument, "-pubkeys") == 0)
+								{
+									strcpy(gPubKeysFileName, argv[ci]);
+									ci++;
+								}
+								else
+									if (strcmp(argument, "-jobs") == 0)
+									{
+										strcpy(gJobsFileName, argv[ci]);
+										ci++;
+									}
+									else
+										if (strcmp(argument, "-results") == 0)
+										{
+											strcpy(gResultsFileName, argv[ci]);
+											ci++;
+										}
+										else
+											if (strcmp(argument, "-bench-dp") == 0)
+											{
+												int dp_min = 0, dp_max = 0, cnt = 10;
+												int n = sscanf(argv[ci], "%d:%d:%d", &dp_min, &dp_max, &cnt);
+												ci++;
+												if ((n < 2) || (dp_min < 4) || (dp_max > 60) || (dp_min > dp_max) || (cnt < 1))
+												{
+													printf("error: invalid value for -bench-dp option\r\n");
+													return false;
+												}
+												gBenchDpMin = dp_min;
+												gBenchDpMax = dp_max;
+												gBenchDpCnt = cnt;
+											}
+											else
+												if (strcmp(argument, "-max") == 0)
+												{
+													double val = atof(argv[ci]);
+													ci++;
+													if (val < 0.00001)
+													{
+														printf("error: invalid value for -max option\r\n");
+														return false;
+													}
+													gMax = val;
+												}
+												else
+													if (strcmp(argument, "-dbbench") == 0)
+													{
+														double val = atof(argv[ci]);
+														ci++;
+														if (val <= 0)
+														{
+															printf("error: invalid value for -dbbench option\r\n");
+															return false;
+														}
+														gDbBenchCnt = (u64)(val * 1000000);
+													}
+													else
+														if (strcmp(argument, "-hugepages") == 0)
+														{
+															if (strcmp(argv[ci], "thp") == 0)
+																gDbHugeMode = DB_HUGE_THP;
+															else
+																if (strcmp(argv[ci], "2m") == 0)
+																	gDbHugeMode = DB_HUGE_2MB;
+																else
+																	if (strcmp(argv[ci], "1g") == 0)
+																		gDbHugeMode = DB_HUGE_1GB;
+																	else
+																	{
+																		printf("error: invalid value for -hugepages option\r\n");
+																		return false;
+																	}
+															ci++;
+														}
+														else
+															if (strcmp(argument, "-numa") == 0)
+															{
+																if (strcmp(argv[ci], "interleave") == 0)
+																	gDbNumaMode = DB_NUMA_INTERLEAVE;
+																else
+																	if (strcmp(argv[ci], "bind") == 0)
+																		gDbNumaMode = DB_NUMA_BIND;
+																	else
+																	{
+																		printf("error: invalid value for -numa option\r\n");
+																		return false;
+																	}
+																ci++;
+															}
+															else
+																if (strcmp(argument, "-ram") == 0)
+																{
+																	double val = atof(argv[ci]);
+																	ci++;
+																	if (val <= 0)
+																	{
+																		printf("error: invalid value for -ram option\r\n");
+																		return false;
+																	}
+																	gRamLimit = val;
+																}
+																else
+																	if (strcmp(argument, "-checkpoint") == 0)
+																	{
+																		strcpy(gCheckpointFileName, argv[ci]);
+																		ci++;
+																	}
+																	else
+																		if (strcmp(argument, "-checkpoint-interval") == 0)
+																		{
+																			double val = atof(argv[ci]);
+																			ci++;
+																			if (val <= 0)
+																			{
+																				printf("error: invalid value for -checkpoint-interval option\r\n");
+																				return false;
+																			}
+																			gCheckpointInterval = val;
+																		}
+																		else
+																			if (strcmp(argument, "-resume") == 0)
+																				gResume = true;
+																			else
+																				if (strcmp(argument, "-journal") == 0)
+																				{
+																					double val = atof(argv[ci]);
+																					ci++;
+																					if (val <= 0)
+																					{
+																						printf("error: invalid value for -journal option\r\n");
+																						return false;
+																					}
+																					gJournalSync = val;
+																				}
+																				else
+																					if (strcmp(argument, "-tames-extend") == 0)
+																						gTamesExtend = true;
+																					else
+																						if (strcmp(argument, "-wilds") == 0)
+																						{
+																							strcpy(gWildsFileName, argv[ci]);
+																							ci++;
+																						}
+																						else
+																							if (strcmp(argument, "-server") == 0)
+																							{
+																								int port = atoi(argv[ci]);
+																								ci++;
+																								if ((port < 1) || (port > 65535))
+																								{
+																									printf("error: invalid value for -server option\r\n");
+																									return false;
+																								}
+																								gServerPort = port;
+																							}
+																							else
+																								if (strcmp(argument, "-client") == 0)
+																								{
+																									//"host:port" or list of shards "host1:port1,host2:port2,..."
+																									char* str = argv[ci];
+																									ci++;
+																									gServerCnt = 0;
+																									while (*str)
+																									{
+																										char* end = strchr(str, ',');
+																										int len = end ? (int)(end - str) : (int)strlen(str);
+																										char item[300];
+																										char* colon = NULL;
+																										if (len < (int)sizeof(item))
+																										{
+																											memcpy(item, str, len);
+																											item[len] = 0;
+																											colon = strrchr(item, ':');
+																										}
+																										int port = colon ? atoi(colon + 1) : 0;
+																										if (!colon || (colon == item) || (colon - item >= (int)sizeof(gServerHost[0])) || (port < 1) || (port > 65535) || (gServerCnt >= NET_MAX_SHARDS))
+																										{
+																											printf("error: invalid value for -client option, use host:port or host1:port1,host2:port2,...\r\n");
+																											return false;
+																										}
+																										*colon = 0;
+																										strcpy(gServerHost[gServerCnt], item);
+																										gServerHostPort[gServerCnt] = port;
+																										gServerCnt++;
+																										str += len;
+																										if (*str)
+																											str++;
+																									}
+																								}
+																								else
+																									if (strcmp(argument, "-wirebench") == 0)
+																									{
+																										double val = atof(argv[ci]);
+																										ci++;
+																										if (val <= 0)
+																										{
+																											printf("error: invalid value for -wirebench option\r\n");
+																											return false;
+																										}
+																										gWireBenchCnt = (u64)(val * 1000000);
+																									}
+																									else
+																										if (strcmp(argument, "-shard") == 0)
+																										{
+																											int ind = -1, cnt = 0;
+																											sscanf(argv[ci], "%d/%d", &ind, &cnt);
+																											ci++;
+																											if ((cnt < 1) || (cnt > NET_MAX_SHARDS) || (ind < 0) || (ind >= cnt))
+																											{
+																												printf("error: invalid value for -shard option, use index/count, for example 0/4\r\n");
+																												return false;
+																											}
+																											gShardIndex = ind;
+																											gShardCnt = cnt;
+																										}
+																										else
+																											if (strcmp(argument, "-node-id") == 0)
+																											{
+																												int val = atoi(argv[ci]);
+																												ci++;
+																												if (val < 0)
+																												{
+																													printf("error: invalid value for -node-id option\r\n");
+																													return false;
+																												}
+																												gNodeId = val;
+																											}
+																											else
+																												if (strcmp(argument, "-node-count") == 0)
+																												{
+																													int val = atoi(argv[ci]);
+																													ci++;
+																													if ((val < 1) || (val > MAX_NODE_CNT))
+																													{
+																														printf("error: invalid value for -node-count option, must be 1..%d\r\n", MAX_NODE_CNT);
+																														return false;
+																													}
+																													gNodeCnt = val;
+																												}
+																												else
+																													if (strcmp(argument, "-node-epoch") == 0)
+																													{
+																														gNodeEpoch = strtoull(argv[ci], NULL, 10);
+																														ci++;
+																													}
+																													else
+																														if (strcmp(argument, "-shm-server") == 0)
+																														{
+																															if (!argv[ci][0] || (strlen(argv[ci]) >= 200) || strpbrk(argv[ci], "/\\"))
+																															{
+																																printf("error: invalid value for -shm-server option\r\n");
+																																return false;
+																															}
+																															strcpy(gShmServerName, argv[ci]);
+																															ci++;
+																														}
+																														else
+																															if (strcmp(argument, "-shm-client") == 0)
+																															{
+																																if (!argv[ci][0] || (strlen(argv[ci]) >= 200) || strpbrk(argv[ci], "/\\"))
+																																{
+																																	printf("error: invalid value for -shm-client option\r\n");
+																																	return false;
+																																}
+																																strcpy(gShmClientName, argv[ci]);
+																																ci++;
+																															}
+																															else
+																																if (strcmp(argument, "-tames-server") == 0)
+																																{
+																																	if (!argv[ci][0] || (strlen(argv[ci]) >= 200) || strpbrk(argv[ci], "/\\"))
+																																	{
+																																		printf("error: invalid value for -tames-server option\r\n");
+																																		return false;
+																																	}
+																																	strcpy(gTamesServerName, argv[ci]);
+																																	ci++;
+																																}
+																																else
+																																	if (strcmp(argument, "-tames-service") == 0)
+																																	{
+																																		if (!argv[ci][0] || (strlen(argv[ci]) >= 200) || strpbrk(argv[ci], "/\\"))
+																																		{
+																																			printf("error: invalid value for -tames-service option\r\n");
+																																			return false;
+																																		}
+																																		strcpy(gTamesServiceName, argv[ci]);
+																																		ci++;
+																																	}
+																																	else
+																																		if (strcmp(argument, "-tames-merge") == 0)
+																																		{
+																																			//list of files "file1,file2,..."
+																																			char* str = argv[ci];
+																																			ci++;
+																																			gTamesMergeFiles.clear();
+																																			while (*str)
+																																			{
+																																				char* end = strchr(str, ',');
+																																				if (end)
+																																					*end = 0;
+																																				if (*str)
+																																					gTamesMergeFiles.push_back(str);
+																																				if (!end)
+																																					break;
+																																				str = end + 1;
+																																			}
+																																			if (gTamesMergeFiles.empty())
+																																			{
+																																				printf("error: invalid value for -tames-merge option, use file1,file2,...\r\n");
+																																				return false;
+																																			}
+																																		}
+																																		else
+																																			if (strcmp(argument, "-tames-out") == 0)
+																																			{
+																																				strcpy(gTamesOutFileName, argv[ci]);
+																																				ci++;
+																																			}
+																																			else
+																																				if (strcmp(argument, "-tames-dp") == 0)
+																																				{
+																																					int val = atoi(argv[ci]);
+																																					ci++;
+																																					if ((val < 4) || (val > 60))
+																																					{
+																																						printf("error: invalid value for -tames-dp option\r\n");
+																																						return false;
+																																					}
+																																					gTamesDP = val;
+																																				}
+																																				else
+																																					if (strcmp(argument, "-tames-verify") == 0)
+																																					{
+																																						double val = atof(argv[ci]);
+																																						ci++;
+																																						if ((val <= 0) || (val > 100))
+																																						{
+																																							printf("error: invalid value for -tames-verify option\r\n");
+																																							return false;
+																																						}
+																																						gTamesVerify = val;
+																																					}
+																																					else
+																																					{
+																																						printf("error: unknown option %s\r\n", argument);
+																																						return false;
+																																					}
+	}
+	if (!gPubKey.x.IsZero() && gPubKeysFileName[0])
+	{
+		printf("error: -pubkey and -pubkeys options cannot be used together\r\n");
+		return false;
+	}
+	if (gBenchDpMin && (!gPubKey.x.IsZero() || gPubKeysFileName[0] || gJobsFileName[0] || gTamesFileName[0]))
+	{
+		printf("error: -bench-dp option cannot be used together with -pubkey, -pubkeys, -jobs or -tames\r\n");
+		return false;
+	}
+	if (gCheckpointFileName[0] && gPubKey.x.IsZero())
+	{
+		printf("error: -checkpoint option can be used with -pubkey only\r\n");
+		return false;
+	}
+	if (gWildsFileName[0] && (gPubKey.x.IsZero() || gCheckpointFileName[0]))
+	{
+		printf("error: -wilds option can be used with -pubkey only and cannot be used with -checkpoint\r\n");
+		return false;
+	}
+	if ((gServerPort || gShmServerName[0] || gServerCnt || gShmClientName[0]) && (gPubKey.x.IsZero() || gCheckpointFileName[0] || gWildsFileName[0]))
+	{
+		printf("error: -server, -shm-server, -client and -shm-client options can be used with -pubkey only and cannot be used with -checkpoint or -wilds\r\n");
+		return false;
+	}
+	if ((gServerCnt || gShmClientName[0]) && gTamesFileName[0])
+	{
+		printf("error: -client and -shm-client options cannot be used with -tames, load tames on the server\r\n");
+		return false;
+	}
+	if ((gServerPort || gShmServerName[0]) && (gServerCnt || gShmClientName[0] || gDpAuto))
+	{
+		printf("error: -server and -shm-server options cannot be used with -client, -shm-client or -dp auto\r\n");
+		return false;
+	}
+	if (gTamesServerName[0] && (!gTamesFileName[0] || !IsFileExist(gTamesFileName) || !gPubKey.x.IsZero() || gPubKeysFileName[0] || gJobsFileName[0] || gServerPort || gShmServerName[0]))
+	{
+		printf("error: -tames-server option requires existing -tames file and cannot be used with -pubkey, -pubkeys, -jobs, -server or -shm-server\r\n");
+		return false;
+	}
+	if (gTamesServiceName[0] && (gTamesFileName[0] || gServerPort || gShmServerName[0] || gServerCnt || gShmClientName[0]))
+	{
+		printf("error: -tames-service option cannot be used with -tames, -server, -shm-server, -client or -shm-client\r\n");
+		return false;
+	}
+	if (!gTamesMergeFiles.empty() && !gTamesOutFileName[0])
+	{
+		printf("error: -tames-merge option requires -tames-out option\r\n");
+		return false;
+	}
+	if (gTamesOutFileName[0] && gTamesMergeFiles.empty() && (!gTamesDP || !gTamesFileName[0] || !IsFileExist(gTamesFileName)))
+	{
+		printf("error: -tames-out option requires -tames-merge option, or existing -tames file and -tames-dp option\r\n");
+		return false;
+	}
+	if (gTamesVerify && (!gTamesFileName[0] || !IsFileExist(gTamesFileName)))
+	{
+		printf("error: -tames-verify option requires existing -tames file\r\n");
+		return false;
+	}
+	if (gTamesDP && !gTamesFileName[0])
+	{
+		printf("error: -tames-dp option requires -tames option\r\n");
+		return false;
+	}
+	if (gServerCnt && gShmClientName[0])
+	{
+		printf("error: -client and -shm-client options cannot be used together\r\n");
+		return false;
+	}
+	if ((gNodeId || gNodeEpoch) && !gNodeCnt)
+	{
+		printf("error: -node-id and -node-epoch options require -node-count option\r\n");
+		return false;
+	}
+	if (gNodeCnt && (gNodeId >= gNodeCnt))
+	{
+		printf("error: -node-id must be less than -node-count\r\n");
+		return false;
+	}
+	if ((gShardCnt > 1) && (!gServerPort || gShmServerName[0]))
+	{
+		printf("error: -shard option requires -server option and cannot be used with -shm-server\r\n");
+		return false;
+	}
+	if (gTamesExtend && (!gTamesFileName[0] || !IsFileExist(gTamesFileName) || (gMax == 0.0) || !gPubKey.x.IsZero() || gPubKeysFileName[0] || gJobsFileName[0]))
+	{
+		printf("error: -tames-extend option requires existing -tames file and -max option, and cannot be used with -pubkey, -pubkeys or -jobs\r\n");
+		return false;
+	}
+	if ((gJournalSync > 0) && !gCheckpointFileName[0])
+	{
+		printf("error: -journal option requires -checkpoint option\r\n");
+		return false;
+	}
+	if (gResume && (!gCheckpointFileName[0] || !IsFileExist(gCheckpointFileName)))
+	{
+		printf("error: -resume option requires existing -checkpoint file\r\n");
+		return false;
+	}
+	if (gDpAuto)
+	{
+		if (gRamLimit <= 0)
+		{
+			printf("error: -dp auto requires -ram option\r\n");
+			return false;
+		}
+		if (gBenchDpMin)
+		{
+			printf("error: -dp auto and -bench-dp options cannot be used together\r\n");
+			return false;
+		}
+		if (gTamesFileName[0] && IsFileExist(gTamesFileName))
+		{
+			printf("error: -dp auto cannot be used with existing tames file, use DP of tames\r\n");
+			return false;
+		}
+	}
+	if (gJobsFileName[0])
+	{
+		if (!gPubKey.x.IsZero() || gPubKeysFileName[0])
+		{
+			printf("error: -jobs option cannot be used together with -pubkey or -pubkeys\r\n");
+			return false;
+		}
+		if (!gDP && !gDpAuto)
+		{
+			printf("error: you must also specify -dp option\r\n");
+			return false;
+		}
+	}
+	if (!gPubKey.x.IsZero() || gPubKeysFileName[0])
+		if (!gStartSet || !gRange || (!gDP && !gDpAuto))
+		{
+			printf("error: you must also specify -dp, -range and -start options\r\n");
+			return false;
+		}
+	if (gTamesFileName[0] && !IsFileExist(gTamesFileName))
+	{
+		if (gMax == 0.0)
+		{
+			printf("error: you must also specify -max option to generate tames\r\n");
+			return false;
+		}
+		gGenMode = true;
+	}
+	if (gTamesExtend)
+		gGenMode = true;
+	return true;
+}
+
+/**
+ * @brief Shows found private key and appends it to RESULTS.TXT.
+ *
+ * @param pk The private key.
+ */
+void SaveKey(EcInt& pk)
+{
+	char s[100];
+	pk.GetHexStr(s);
+	printf("\r\nPRIVATE KEY: %s\r\n\r\n", s);
+	FILE* fp = fopen("RESULTS.TXT", "a");
+	if (fp)
+	{
+		fprintf(fp, "PRIVATE KEY: %s\n", s);
+		fclose(fp);
+	}
+	else //we cannot save the key, show error and wait forever so the key is displayed
+	{
+		printf("WARNING: Cannot save the key to RESULTS.TXT!\r\n");
+		while (1)
+			Sleep(100);
+	}
+}
+
+/**
+ * @brief Loads public keys from text file, one key per line, empty lines and lines starting with '#' are skipped.
+ *
+ * @param fn The file name.
+ * @param keys Receives the keys.
+ * @return true If all keys are valid.
+ * @return false Otherwise.
+ */
+bool LoadPubKeys(char* fn, std::vector <EcPoint>& keys)
+{
+	FILE* fp = fopen(fn, "rt");
+	if (!fp)
+	{
+		printf("error: cannot open %s\r\n", fn);
+		return false;
+	}
+	char line[1024];
+	int line_ind = 0;
+	while (fgets(line, sizeof(line), fp))
+	{
+		line_ind++;
+		int len = (int)strlen(line);
+		while (len && ((line[len - 1] == '\r') || (line[len - 1] == '\n') || (line[len - 1] == ' ') || (line[len - 1] == '\t')))
+			line[--len] = 0;
+		if (!len || (line[0] == '#'))
+			continue;
+		EcPoint pnt;
+		if (!pnt.SetHexStr(line))
+		{
+			printf("error: invalid public key in line %d of %s\r\n", line_ind, fn);
+			fclose(fp);
+			return false;
+		}
+		keys.push_back(pnt);
+	}
+	fclose(fp);
+	if (keys.empty())
+	{
+		printf("error: no public keys in %s\r\n", fn);
+		return false;
+	}
+	return true;
+}
+
+/**
+ * @brief Solves all public keys from -pubkeys file, up to MAX_TARGET_CNT keys at once with shared tames.
+ */
+void SolvePubKeys()
+{
+	printf("\r\nMULTI-TARGET MODE\r\n\r\n");
+	std::vector <EcPoint> keys;
+	if (!LoadPubKeys(gPubKeysFileName, keys))
+		return;
+	char sx_start[100];
+	gStart.GetHexStr(sx_start);
+	printf("Public keys: %d, offset: %s\r\n", (int)keys.size(), sx_start);
+	EcPoint PntOfs;
+	if (!gStart.IsZero())
+	{
+		PntOfs = ec.MultiplyG(gStart);
+		PntOfs.y.NegModP();
+	}
+	//shared tames stay in DB between groups
+	for (int g = 0; g < (int)keys.size(); g += MAX_TARGET_CNT)
+	{
+		int cnt = (int)keys.size() - g;
+		if (cnt > MAX_TARGET_CNT)
+			cnt = MAX_TARGET_CNT;
+		EcPoint pnts[MAX_TARGET_CNT];
+		EcInt pks[MAX_TARGET_CNT];
+		bool solved[MAX_TARGET_CNT];
+		for (int i = 0; i < cnt; i++)
+			pnts[i] = gStart.IsZero() ? keys[g + i] : ec.AddPoints(keys[g + i], PntOfs);
+		if (SolvePoints(pnts, cnt, gRange, gDP, pks, solved) < 0)
+		{
+			printf("FATAL ERROR: SolvePoints failed\r\n");
+			return;
+		}
+		for (int i = 0; i < cnt; i++)
+		{
+			char sx[100];
+			keys[g + i].x.GetHexStr(sx);
+			if (!solved[i])
+			{
+				printf("Public key X: %s not solved\r\n", sx);
+				continue;
+			}
+			pks[i].AddModP(gStart);
+			EcPoint tmp = ec.MultiplyG(pks[i]);
+			if (!tmp.IsEqual(keys[g + i]))
+			{
+				printf("FATAL ERROR: SolvePoints found incorrect key for X: %s\r\n", sx);
+				continue;
+			}
+			printf("Public key X: %s\r\n", sx);
+			SaveKey(pks[i]);
+		}
+		if (gIsOpsLimit)
+			break;
+	}
+}
+
+struct TJob
+{
+	char id[64];
+	char start[100];
+	char end[100];
+	char pubkey[140];
+	EcInt Start;
+	EcPoint PubKey;
+	int Range;
+};
+
+struct TJobResult
+{
+	bool solved;
+	int dp;
+	char pk[100];
+	double time_sec;
+	u64 ops;
+	double K;
+};
+
+/**
+ * @brief Removes spaces, quotes and "0x" prefix from CSV field in place.
+ */
+char* TrimCsvField(char* str)
 {
-	if ((Range < 19) || (Range > 160))
+	while ((*str == ' ') || (*str == '\t') || (*str == '"'))
+		str++;
+	int len = (int)strlen(str);
+	while (len && ((str[len - 1] == ' ') || (str[len - 1] == '\t') || (str[len - 1] == '"') || (str[len - 1] == '\r') || (str[len - 1] == '\n')))
+		str[--len] = 0;
+	return str;
+}
+
+/**
+ * @brief Loads jobs from CSV file like Puzzles_30-160.csv.
+ *
+ * Columns are found by header names ("start...", "end...", "pub...", other column is job id),
+ * without header rows must be "start,end,pubkey" or "id,start,end,pubkey". Range of the job is bit length of (end - start).
+ *
+ * @param fn The file name.
+ * @param jobs Receives the jobs.
+ * @return true If all rows are valid.
+ * @return false Otherwise.
+ */
+bool LoadJobs(char* fn, std::vector <TJob>& jobs)
+{
+	FILE* fp = fopen(fn, "rt");
+	if (!fp)
 	{
-		printf("Unsupported Range value (%d)!\r\n", Range);
+		printf("error: cannot open %s\r\n", fn);
 		return false;
 	}
-	if ((DP < 4) || (DP > 60)) // Temp Change to Allow for lower DP to build DP model from various runs over bit ranges for DP alorithm
+	int col_id = -1, col_start = -1, col_end = -1, col_pub = -1;
+	char line[1024];
+	int line_ind = 0;
+	while (fgets(line, sizeof(line), fp))
 	{
-		printf("Unsupported DP value (%d)!\r\n", DP);
+		line_ind++;
+		char* fields[16];
+		int cnt = 0;
+		char* p = line;
+		while (cnt < 16)
+		{
+			fields[cnt++] = p;
+			p = strchr(p, ',');
+			if (!p)
+				break;
+			*p++ = 0;
+		}
+		for (int i = 0; i < cnt; i++)
+			fields[i] = TrimCsvField(fields[i]);
+		if ((cnt == 1) && !fields[0][0])
+			continue; //empty line
+		if (col_pub < 0)
+		{
+			for (int i = 0; i < cnt; i++)
+				if (!strncmp(fields[i], "pub", 3))
+					col_pub = i;
+			if (col_pub >= 0) //header
+			{
+				for (int i = 0; i < cnt; i++)
+					if (!strncmp(fields[i], "start", 5))
+						col_start = i;
+					else
+						if (!strncmp(fields[i], "end", 3))
+							col_end = i;
+						else
+							if ((i != col_pub) && (col_id < 0))
+								col_id = i;
+				if ((col_start < 0) || (col_end < 0))
+				{
+					printf("error: no start or end column in %s\r\n", fn);
+					fclose(fp);
+					return false;
+				}
+				continue;
+			}
+			col_id = (cnt > 3) ? 0 : -1;
+			col_start = (cnt > 3) ? 1 : 0;
+			col_end = col_start + 1;
+			col_pub = col_start + 2;
+		}
+		if ((cnt <= col_pub) || (cnt <= col_start) || (cnt <= col_end) || (cnt <= col_id))
+		{
+			printf("error: not enough columns in line %d of %s\r\n", line_ind, fn);
+			fclose(fp);
+			return false;
+		}
+		TJob job;
+		if (col_id >= 0)
+			sprintf(job.id, "%.63s", fields[col_id]);
+		else
+			sprintf(job.id, "%d", (int)jobs.size() + 1);
+		char* start = fields[col_start];
+		char* end = fields[col_end];
+		if ((start[0] == '0') && ((start[1] == 'x') || (start[1] == 'X')))
+			start += 2;
+		if ((end[0] == '0') && ((end[1] == 'x') || (end[1] == 'X')))
+			end += 2;
+		sprintf(job.start, "%.99s", start);
+		sprintf(job.end, "%.99s", end);
+		sprintf(job.pubkey, "%.139s", fields[col_pub]);
+		EcInt End;
+		if (!job.Start.SetHexStr(job.start) || !End.SetHexStr(job.end) || !job.PubKey.SetHexStr(job.pubkey) || !job.Start.IsLessThanU(End))
+		{
+			printf("error: invalid values in line %d of %s\r\n", line_ind, fn);
+			fclose(fp);
+			return false;
+		}
+		End.Sub(job.Start);
+		job.Range = 0;
+		for (int i = 3; i >= 0; i--)
+			if (End.data[i])
+			{
+				u32 ind;
+				_BitScanReverse64(&ind, End.data[i]);
+				job.Range = 64 * i + ind + 1;
+				break;
+			}
+		jobs.push_back(job);
+	}
+	fclose(fp);
+	if (jobs.empty())
+	{
+		printf("error: no jobs in %s\r\n", fn);
 		return false;
 	}
+	return true;
+}
 
-	printf("\r\nSolving point: Range %d bits, DP %d, start...\r\n", Range, DP);
-	double ops = 1.15 * pow(2.0, Range / 2.0);
-	double dp_val = (double)(1ull << DP);
-	double ram = (32 + 4 + 4) * ops / dp_val; //+4 for grow allocation and memory fragmentation
-	ram += sizeof(TListRec) * 256 * 256 * 256; //3byte-prefix table
-	ram /= (1024 * 1024 * 1024); //GB
-	printf("SOTA method, estimated ops: 2^%.3f, RAM for DPs: %.3f GB. DP and GPU overheads not included!\r\n", log2(ops), ram);
-	gIsOpsLimit = false;
-	double MaxTotalOps = 0.0;
-	if (gMax > 0)
+/**
+ * @brief Writes results of finished jobs, JSON if file name ends with ".json", otherwise CSV.
+ *
+ * File is rewritten after every job so it's always complete and valid.
+ */
+bool SaveJobResults(char* fn, std::vector <TJob>& jobs, std::vector <TJobResult>& results)
+{
+	FILE* fp = fopen(fn, "wt");
+	if (!fp)
+		return false;
+	int len = (int)strlen(fn);
+	bool json = (len > 5) && !strcmp(fn + len - 5, ".json");
+	if (json)
+		fprintf(fp, "[\n");
+	else
+		fprintf(fp, "id,start,end,pubkey,range,dp,solved,private_key,time_sec,ops,K\n");
+	for (int i = 0; i < (int)results.size(); i++)
 	{
-		MaxTotalOps = gMax * ops;
-		double ram_max = (32 + 4 + 4) * MaxTotalOps / dp_val; //+4 for grow allocation and memory fragmentation
-		ram_max += sizeof(TListRec) * 256 * 256 * 256; //3byte-prefix table
-		ram_max /= (1024 * 1024 * 1024); //GB
-		printf("Max allowed number of ops: 2^%.3f, max RAM for DPs: %.3f GB\r\n", log2(MaxTotalOps), ram_max);
+		TJob* job = &jobs[i];
+		TJobResult* res = &results[i];
+		if (json)
+			fprintf(fp, "  {\"id\": \"%s\", \"start\": \"%s\", \"end\": \"%s\", \"pubkey\": \"%s\", \"range\": %d, \"dp\": %d, \"solved\": %s, \"private_key\": \"%s\", \"time_sec\": %.3f, \"ops\": %llu, \"K\": %.3f}%s\n",
+				job->id, job->start, job->end, job->pubkey, job->Range, res->dp, res->solved ? "true" : "false", res->pk, res->time_sec, res->ops, res->K, (i + 1 < (int)results.size()) ? "," : "");
+		else
+			fprintf(fp, "%s,%s,%s,%s,%d,%d,%d,%s,%.3f,%llu,%.3f\n",
+				job->id, job->start, job->end, job->pubkey, job->Range, res->dp, res->solved ? 1 : 0, res->pk, res->time_sec, res->ops, res->K);
 	}
+	if (json)
+		fprintf(fp, "]\n");
+	fclose(fp);
+	return true;
+}
 
-	u64 total_kangs = GpuKangs[0]->CalcKangCnt();
-	for (int i = 1; i < GpuCnt; i++)
+/**
+ * @brief Solves all jobs from -jobs file back to back in one session, writes -results file.
+ *
+ * Session (jumps, GPU memory, threads) is reused while range is the same, tame DPs are shared by jobs of the same range.
+ */
+void RunJobs()
+{
+	printf("\r\nJOBS MODE\r\n\r\n");
+	std::vector <TJob> jobs;
+	if (!LoadJobs(gJobsFileName, jobs))
+		return;
+	if (gDpAuto)
+		printf("Jobs: %d, DP auto, RAM %.1f GB\r\n", (int)jobs.size(), gRamLimit);
+	else
+		printf("Jobs: %d, DP %d\r\n", (int)jobs.size(), gDP);
+	std::vector <TJobResult> results;
+	u64 tm_total = GetTickCount64();
+	for (int i = 0; i < (int)jobs.size(); i++)
+	{
+		TJob* job = &jobs[i];
+		printf("\r\nJob %d of %d, id %s, range %d bits\r\n", i + 1, (int)jobs.size(), job->id, job->Range);
+		TJobResult res;
+		memset(&res, 0, sizeof(res));
+		EcPoint PntToSolve = job->PubKey;
+		if (!job->Start.IsZero())
+		{
+			EcPoint PntOfs = ec.MultiplyG(job->Start);
+			PntOfs.y.NegModP();
+			PntToSolve = ec.AddPoints(PntToSolve, PntOfs);
+		}
+		u64 tm = GetTickCount64();
+		EcInt pk_found;
+		res.solved = SolvePoint(PntToSolve, job->Range, gDP, &pk_found);
+		res.time_sec = (GetTickCount64() - tm) / 1000.0;
+		res.dp = gSessionDP;
+		res.ops = PntTotalOps;
+		res.K = (double)PntTotalOps / pow(2.0, job->Range / 2.0);
+		if (res.solved)
+		{
+			pk_found.AddModP(job->Start);
+			EcPoint tmp = ec.MultiplyG(pk_found);
+			if (tmp.IsEqual(job->PubKey))
+			{
+				pk_found.GetHexStr(res.pk);
+				SaveKey(pk_found);
+			}
+			else
+			{
+				printf("FATAL ERROR: SolvePoint found incorrect key\r\n");
+				res.solved = false;
+			}
+		}
+		results.push_back(res);
+		if (gResultsFileName[0] && !SaveJobResults(gResultsFileName, jobs, results))
+			printf("WARNING: Cannot save results to %s!\r\n", gResultsFileName);
+		printf("Job %s: %s, %.3f sec, K: %.3f\r\n", job->id, res.solved ? "solved" : "NOT solved", res.time_sec, res.K);
+	}
+	int solved = 0;
+	for (int i = 0; i < (int)results.size(); i++)
+		solved += results[i].solved ? 1 : 0;
+	printf("\r\nJobs finished: %d of %d solved, total time %.3f sec\r\n", solved, (int)jobs.size(), (GetTickCount64() - tm_total) / 1000.0);
+}
+
+static int cmp_double(const void* a, const void* b)
+{
+	double d = *(double*)a - *(double*)b;
+	return (d > 0) - (d < 0);
+}
+
+static double Median(std::vector <double>& vals)
+{
+	if (vals.empty())
+		return 0.0;
+	std::vector <double> tmp = vals;
+	qsort(tmp.data(), tmp.size(), sizeof(double), cmp_double);
+	int n = (int)tmp.size();
+	return (n & 1) ? tmp[n / 2] : (tmp[n / 2 - 1] + tmp[n / 2]) / 2;
+}
+
+struct TDpSweepRes
+{
+	int dp;
+	int solved;
+	int cnt;
+	double mean_K;
+	double median_K;
+	double dp_overhead; //estimated, part of expected ops
+	double db_recs;
+	double db_mb;
+	double mean_time;
+	double median_time;
+};
+
+/**
+ * @brief Benchmark for -bench-dp: solves gBenchDpCnt random points for every DP value in one process.
+ *
+ * Shows mean/median K, DP overhead, DB size and time to solve for every DP, results also go to -results file (CSV or JSON).
+ */
+void RunDpSweep()
+{
+	if (!gRange)
+		gRange = 78;
+	printf("\r\nDP SWEEP BENCHMARK MODE\r\n");
+	printf("Range %d bits, DP %d...%d, %d points per DP\r\n", gRange, gBenchDpMin, gBenchDpMax, gBenchDpCnt);
+	u64 total_kangs = 0;
+	for (int i = 0; i < GpuCnt; i++)
 		total_kangs += GpuKangs[i]->CalcKangCnt();
-	double path_single_kang = ops / total_kangs;
-	double DPs_per_kang = path_single_kang / dp_val;
-	printf("Estimated DPs per kangaroo: %.3f.%s\r\n", DPs_per_kang, (DPs_per_kang < 5) ? " DP overhead is big, use less DP value if possible!" : "");
+	double exp_ops = 1.15 * pow(2.0, gRange / 2.0);
+	std::vector <TDpSweepRes> results;
+	for (int dp = gBenchDpMin; dp <= gBenchDpMax; dp++)
+	{
+		std::vector <double> Ks, times;
+		TDpSweepRes res;
+		memset(&res, 0, sizeof(res));
+		res.dp = dp;
+		res.cnt = gBenchDpCnt;
+		for (int i = 0; i < gBenchDpCnt; i++)
+		{
+			EcInt pk, pk_found;
+			pk.RndBits(gRange);
+			EcPoint PntToSolve = ec.MultiplyG(pk);
+			u64 tm = GetTickCount64();
+			bool ok = SolvePoint(PntToSolve, gRange, dp, &pk_found);
+			double tm_sec = (GetTickCount64() - tm) / 1000.0;
+			if (!ok || !pk_found.IsEqual(pk))
+			{
+				if (ok)
+					printf("FATAL ERROR: Found key is wrong!\r\n");
+				continue;
+			}
+			res.solved++;
+			Ks.push_back((double)PntTotalOps / pow(2.0, gRange / 2.0));
+			times.push_back(tm_sec);
+			res.db_recs += (double)gLastDbStats.RecCnt;
+			res.db_mb += (double)(gLastDbStats.PoolBytes + gLastDbStats.ListBytes) / (1024 * 1024);
+		}
+		if (res.solved)
+		{
+			for (int i = 0; i < res.solved; i++)
+			{
+				res.mean_K += Ks[i] / res.solved;
+				res.mean_time += times[i] / res.solved;
+			}
+			res.median_K = Median(Ks);
+			res.median_time = Median(times);
+			res.db_recs /= res.solved;
+			res.db_mb /= res.solved;
+		}
+		//every kangaroo walks about 2^DP steps after the collision before it gets DP
+		res.dp_overhead = total_kangs * pow(2.0, dp) / exp_ops;
+		results.push_back(res);
+		printf("DP %d: solved %d of %d, mean K %.3f, median K %.3f\r\n", dp, res.solved, res.cnt, res.mean_K, res.median_K);
+	}
+
+	printf("\r\n  DP | solved | mean K | median K | DP overhead |   DB records |    DB MB | mean sec | median sec\r\n");
+	int best = -1;
+	for (int i = 0; i < (int)results.size(); i++)
+	{
+		TDpSweepRes* r = &results[i];
+		printf("%4d | %3d/%-3d | %6.3f | %8.3f | %10.1f%% | %12.0f | %8.1f | %8.3f | %10.3f\r\n", r->dp, r->solved, r->cnt, r->mean_K, r->median_K,
+			100.0 * r->dp_overhead, r->db_recs, r->db_mb, r->mean_time, r->median_time);
+		if ((r->solved == r->cnt) && ((best < 0) || (r->mean_time < results[best].mean_time)))
+			best = i;
+	}
+	if (best >= 0)
+		printf("Fastest DP: %d (mean time %.3f sec)\r\n", results[best].dp, results[best].mean_time);
+
+	if (!gResultsFileName[0])
+		return;
+	FILE* fp = fopen(gResultsFileName, "wt");
+	if (!fp)
+	{
+		printf("WARNING: Cannot save results to %s!\r\n", gResultsFileName);
+		return;
+	}
+	int len = (int)strlen(gResultsFileName);
+	bool json = (len > 5) && !strcmp(gResultsFileName + len - 5, ".json");
+	if (json)
+		fprintf(fp, "[\n");
+	else
+		fprintf(fp, "range,dp,points,solved,mean_K,median_K,dp_overhead,db_records,db_mb,mean_time_sec,median_time_sec\n");
+	for (int i = 0; i < (int)results.size(); i++)
+	{
+		TDpSweepRes* r = &results[i];
+		if (json)
+			fprintf(fp, "  {\"range\": %d, \"dp\": %d, \"points\": %d, \"solved\": %d, \"mean_K\": %.3f, \"median_K\": %.3f, \"dp_overhead\": %.4f, \"db_records\": %.0f, \"db_mb\": %.1f, \"mean_time_sec\": %.3f, \"median_time_sec\": %.3f}%s\n",
+				gRange, r->dp, r->cnt, r->solved, r->mean_K, r->median_K, r->dp_overhead, r->db_recs, r->db_mb, r->mean_time, r->median_time, (i + 1 < (int)results.size()) ? "," : "");
+		else
+			fprintf(fp, "%d,%d,%d,%d,%.3f,%.3f,%.4f,%.0f,%.1f,%.3f,%.3f\n",
+				gRange, r->dp, r->cnt, r->solved, r->mean_K, r->median_K, r->dp_overhead, r->db_recs, r->db_mb, r->mean_time, r->median_time);
+	}
+	if (json)
+		fprintf(fp, "]\n");
+	fclose(fp);
+}
+
+//client of "-server" mode
+struct TNetClient
+{
+	TcpSocket sock;
+	char name[32];
+	volatile bool active;
+	u64 dps;
+	u64 ops;
+	HHANDLER thr;
+};
+
+CriticalSection csServer; //DB and client counters in server mode
+volatile bool gServerExit;
+TNetHello gServerHello; //clients must send the same point, range and DP
+bool gServerJumpHashSet; //jumps of the first client, other clients must have the same jumps
+
+//solver of "-shm-server" mode, local state of the slot
+struct TShmClient
+{
+	u32 state;
+	u64 tm; //when state was changed
+	u64 ops;
+	u64 dps;
+};
+
+/**
+ * @brief Checks hello of a client, the first accepted client sets jumps for all others if there are no tames.
+ *
+ * @param hello Hello of the client.
+ * @return true If the client solves the same point with the same range, DP, jumps and shards.
+ */
+bool ServerCheckHello(TNetHello* hello)
+{
+	bool ok = !memcmp(hello->sign, gServerHello.sign, 8) && (hello->version == NET_VERSION) && (hello->range == gServerHello.range) &&
+		(hello->dp == gServerHello.dp) && (hello->shard == gShardIndex) && (hello->shard_cnt == gShardCnt) && !memcmp(hello->pnt, gServerHello.pnt, 64);
+	csServer.Enter();
+	if (ok && !gServerJumpHashSet)
+	{
+		gServerHello.jump_hash = hello->jump_hash;
+		gServerJumpHashSet = true;
+	}
+	ok = ok && (hello->jump_hash == gServerHello.jump_hash);
+	csServer.Leave();
+	return ok;
+}
+
+/**
+ * @brief Drops records that are not DPs for the DP raised by -ram limit, clients keep sending DPs of the initial DP.
+ *
+ * @param recs Records, DB_FULL_REC_LEN bytes each, they are compacted in place.
+ * @param cnt Number of records.
+ * @return Number of records left.
+ */
+int ServerFilterDPs(u8* recs, int cnt)
+{
+	u32 mask = gDPExtMask;
+	if (!mask)
+		return cnt;
+	int res = 0;
+	for (int i = 0; i < cnt; i++)
+		if (!(*(u32*)(recs + i * DB_FULL_REC_LEN + 8) & mask))
+		{
+			if (res != i)
+				memcpy(recs + res * DB_FULL_REC_LEN, recs + i * DB_FULL_REC_LEN, DB_FULL_REC_LEN);
+			res++;
+		}
+	return res;
+}
+
+/**
+ * @brief Thread procedure for one client of DP server: checks hello, then adds received DPs to DB.
+ *
+ * @param data Pointer to TNetClient.
+ */
+#ifdef _WIN32
+u32 __stdcall net_client_thr_proc(void* data)
+#else
+void* net_client_thr_proc(void* data)
+#endif
+{
+	TNetClient* cl = (TNetClient*)data;
+	TNetMsgHdr hdr;
+	std::vector <u8> buf;
+	std::vector <u8> unpacked;
+	Ec ec_thr;
+	bool ok = (cl->sock.WaitRead(10 * 1000) > 0) && cl->sock.RecvMsg(&hdr, buf) && (hdr.type == NET_MSG_HELLO) && (buf.size() == sizeof(TNetHello));
+	if (ok)
+	{
+		ok = ServerCheckHello((TNetHello*)buf.data());
+		TNetHello ans = gServerHello;
+		ans.status = ok ? 0 : 1;
+		ok = cl->sock.SendMsg(NET_MSG_HELLO, &ans, sizeof(ans)) && ok;
+	}
+	printf("Client %s %s\r\n", cl->name, ok ? "connected" : "rejected, it has different point, range, DP, jumps or shards");
+	while (ok && !gServerExit)
+	{
+		int res = cl->sock.WaitRead(100);
+		if (!res)
+			continue;
+		if ((res < 0) || !cl->sock.RecvMsg(&hdr, buf))
+		{
+			printf("Client %s disconnected\r\n", cl->name);
+			break;
+		}
+		if ((hdr.type == NET_MSG_STOP) && (hdr.len == 32))
+		{
+			//other shard found the key, check it
+			EcInt pk;
+			pk.Set(0);
+			memcpy(pk.data, buf.data(), 32);
+			EcPoint P = ec_thr.MultiplyG(pk);
+			if (!P.IsEqual(gTargets[0]))
+				continue;
+			printf("Client %s sent the key found by other shard\r\n", cl->name);
+			csCollisions.Enter();
+			gTargetKeys[0] = pk;
+			gTargetSolved[0] = true;
+			gSolved = true;
+			csCollisions.Leave();
+			continue;
+		}
+		int cnt = -1;
+		u8* recs = buf.data() + 8;
+		if ((hdr.type == NET_MSG_DPS) && (hdr.len >= 8) && !((hdr.len - 8) % DB_FULL_REC_LEN))
+			cnt = (hdr.len - 8) / DB_FULL_REC_LEN;
+		if ((hdr.type == NET_MSG_DPS_PACKED) && (hdr.len >= 12))
+		{
+			int max_cnt = (hdr.len - 12) / 7; //shortest packed record
+			if (*(u32*)(buf.data() + 8) < (u32)max_cnt)
+				max_cnt = *(u32*)(buf.data() + 8);
+			unpacked.resize((u64)max_cnt * DB_FULL_REC_LEN);
+			recs = unpacked.data();
+			cnt = NetDecodeDPs(buf.data() + 8, hdr.len - 8, recs, max_cnt);
+		}
+		if (cnt < 0)
+		{
+			printf("Client %s sent wrong message, disconnected\r\n", cl->name);
+			break;
+		}
+		for (int i = 0; i < cnt; i++)
+		{
+			recs[i * DB_FULL_REC_LEN + DB_FULL_REC_LEN - 1] &= KANG_TYPE_MASK; //one target only
+			if (NetShard(recs + i * DB_FULL_REC_LEN, gShardCnt) != gShardIndex)
+				cnt = -1;
+		}
+		if (cnt < 0)
+		{
+			printf("Client %s sent DPs of other shard, disconnected\r\n", cl->name);
+			break;
+		}
+		csServer.Enter();
+		cl->ops += *(u64*)buf.data();
+		cl->dps += cnt;
+		PntTotalOps += *(u64*)buf.data();
+		cnt = ServerFilterDPs(recs, cnt);
+		db.FindOrAddBatch(recs, cnt, CheckCollision, NULL);
+		csServer.Leave();
+	}
+	cl->sock.Close();
+	cl->active = false;
+	return 0;
+}
 
-	if (!gGenMode && gTamesFileName[0])
+/**
+ * @brief Checks slots of local solvers in shared memory ("-shm-server"): accepts new solvers, frees dead ones and adds DPs from rings to DB.
+ *
+ * @param shm Shared memory of the aggregator.
+ * @param cls Local state of every slot.
+ * @param buf Buffer for records, they are copied from ring because DB batch changes them.
+ * @return Number of records added.
+ */
+u64 ShmServerPoll(ShmRegion& shm, TShmClient* cls, std::vector <u8>& buf)
+{
+	TShmHeader* hdr = (TShmHeader*)shm.GetData();
+	TShmSlot* slots = (TShmSlot*)(shm.GetData() + sizeof(TShmHeader));
+	u64 tm = GetTickCount64();
+	hdr->heartbeat = tm;
+	u64 total = 0;
+	for (int i = 0; i < SHM_SLOT_CNT; i++)
 	{
-		printf("load tames...\r\n");
-		if (db.LoadFromFile(gTamesFileName))
+		TShmSlot* slot = &slots[i];
+		TShmClient* cl = &cls[i];
+		u32 state = slot->state;
+		bool free_slot = false;
+		if (state != cl->state)
+		{
+			if (state == SHM_SLOT_HELLO)
+			{
+				ShmFence();
+				bool ok = ServerCheckHello(&slot->hello);
+				printf("Local process %u (slot %d) %s\r\n", slot->pid, i, ok ? "attached" : "rejected, it has different point, range, DP or jumps");
+				cl->ops = 0;
+				slot->hello.gpu_dp = gServerHello.gpu_dp; //solver switches to DP of aggregator
+				slot->hello.dp_ext_mask = gServerHello.dp_ext_mask;
+				ShmFence();
+				if (ShmCas(&slot->state, SHM_SLOT_HELLO, ok ? SHM_SLOT_ACTIVE : SHM_SLOT_REJECTED))
+					state = ok ? SHM_SLOT_ACTIVE : SHM_SLOT_REJECTED;
+				else
+					state = slot->state; //solver gave up
+			}
+			cl->state = state;
+			cl->tm = tm;
+		}
+		if ((state == SHM_SLOT_ACTIVE) || (state == SHM_SLOT_CLOSED))
 		{
-			printf("tames loaded\r\n");
-			if (db.Header[0] != gRange)
+			u64 tail = slot->tail;
+			u64 cnt = slot->head - tail;
+			ShmFence(); //records before head are visible
+			if (cnt > SHM_RING_RECS)
+				cnt = 0; //broken slot, it's freed below
+			if (cnt)
+			{
+				u8* ring = shm.GetData() + SHM_RING_OFFSET(i);
+				buf.resize(cnt * DB_FULL_REC_LEN);
+				u64 ind = tail & (SHM_RING_RECS - 1);
+				u64 n1 = (cnt < SHM_RING_RECS - ind) ? cnt : SHM_RING_RECS - ind;
+				memcpy(buf.data(), ring + ind * DB_FULL_REC_LEN, n1 * DB_FULL_REC_LEN);
+				memcpy(buf.data() + n1 * DB_FULL_REC_LEN, ring, (cnt - n1) * DB_FULL_REC_LEN);
+				ShmFence();
+				slot->tail = tail + cnt; //solver can reuse this part of ring
+				for (u64 j = 0; j < cnt; j++)
+					buf[j * DB_FULL_REC_LEN + DB_FULL_REC_LEN - 1] &= KANG_TYPE_MASK; //one target only
+			}
+			u64 ops = slot->ops;
+			csServer.Enter();
+			PntTotalOps += ops - cl->ops;
+			cl->ops = ops;
+			cl->dps += cnt;
+			if (cnt)
+				db.FindOrAddBatch(buf.data(), ServerFilterDPs(buf.data(), (int)cnt), CheckCollision, NULL);
+			csServer.Leave();
+			total += cnt;
+			if (slot->head - slot->tail > SHM_RING_RECS)
 			{
-				printf("loaded tames have different range, they cannot be used, clear\r\n");
-				db.Clear();
+				printf("Local process %u (slot %d) has broken ring, slot is freed\r\n", slot->pid, i);
+				free_slot = true;
 			}
+			else
+				if ((state == SHM_SLOT_CLOSED) && (slot->head == slot->tail))
+				{
+					printf("Local process %u (slot %d) detached\r\n", slot->pid, i);
+					free_slot = true;
+				}
+				else
+					if ((state == SHM_SLOT_ACTIVE) && (tm - slot->heartbeat > SHM_TIMEOUT) && (tm - cl->tm > SHM_TIMEOUT))
+					{
+						printf("Local process %u (slot %d) is not responding, slot is freed\r\n", slot->pid, i);
+						free_slot = true;
+					}
 		}
 		else
-			printf("tames loading failed\r\n");
+			if ((state == SHM_SLOT_TAKEN) && (tm - cl->tm > SHM_TIMEOUT))
+				free_slot = true; //process died before hello
+		//only the state we have seen is changed, free slot can be taken by new solver at any moment
+		if (free_slot && ShmCas(&slot->state, state, SHM_SLOT_FREE))
+			cl->state = SHM_SLOT_FREE;
 	}
+	return total;
+}
 
-	SetRndSeed(0); //use same seed to make tames from file compatible
-	PntTotalOps = 0;
-	PntIndex = 0;
-	//prepare jumps
-	EcInt minjump, t;
-	minjump.Set(1);
-	minjump.ShiftLeft(Range / 2 + 3);
-	for (int i = 0; i < JMP_CNT; i++)
+/**
+ * @brief DP server mode: collects DPs of all clients in one DB, checks collisions and sends the key to all clients.
+ *
+ * Every client has its own thread, DPs are added to DB in batches as they come.
+ * With "-shm-server" local solver processes write DPs to shared memory rings instead of TCP, so one DB and one copy of tames serve the whole host.
+ */
+void RunServer()
+{
+	printf("\r\nSERVER MODE\r\n\r\n");
+	EcPoint PntToSolve, PntOfs;
+	PntToSolve = gPubKey;
+	if (!gStart.IsZero())
 	{
-		EcJumps1[i].dist = minjump;
-		t.RndMax(minjump);
-		EcJumps1[i].dist.Add(t);
-		EcJumps1[i].dist.data[0] &= 0xFFFFFFFFFFFFFFFE; //must be even
-		EcJumps1[i].p = ec.MultiplyG(EcJumps1[i].dist);
+		PntOfs = ec.MultiplyG(gStart);
+		PntOfs.y.NegModP();
+		PntToSolve = ec.AddPoints(PntToSolve, PntOfs);
 	}
-
-	minjump.Set(1);
-	minjump.ShiftLeft(Range - 10); //large jumps for L1S2 loops. Must be almost RANGE_BITS
-	for (int i = 0; i < JMP_CNT; i++)
+	if (!db.SetAllocMode(gDbHugeMode, gDbNumaMode) || (gServerPort && !NetInit()))
+		return;
+	TcpSocket listener;
+	if (gServerPort && !listener.Listen(gServerPort))
 	{
-		EcJumps2[i].dist = minjump;
-		t.RndMax(minjump);
-		EcJumps2[i].dist.Add(t);
-		EcJumps2[i].dist.data[0] &= 0xFFFFFFFFFFFFFFFE; //must be even
-		EcJumps2[i].p = ec.MultiplyG(EcJumps2[i].dist);
+		printf("error: cannot listen on port %d\r\n", gServerPort);
+		return;
 	}
-
-	minjump.Set(1);
-	minjump.ShiftLeft(Range - 10 - 2); //large jumps for loops >2
-	for (int i = 0; i < JMP_CNT; i++)
+	ShmRegion shm;
+	TShmClient shm_cls[SHM_SLOT_CNT];
+	std::vector <u8> shm_buf;
+	memset(shm_cls, 0, sizeof(shm_cls));
+	if (gShmServerName[0])
 	{
-		EcJumps3[i].dist = minjump;
-		t.RndMax(minjump);
-		EcJumps3[i].dist.Add(t);
-		EcJumps3[i].dist.data[0] &= 0xFFFFFFFFFFFFFFFE; //must be even
-		EcJumps3[i].p = ec.MultiplyG(EcJumps3[i].dist);
+		if (!shm.Create(gShmServerName, SHM_TOTAL_SIZE))
+		{
+			printf("error: cannot create shared memory %s\r\n", gShmServerName);
+			return;
+		}
+		TShmHeader* shm_hdr = (TShmHeader*)shm.GetData();
+		shm_hdr->version = SHM_VERSION;
+		shm_hdr->slot_cnt = SHM_SLOT_CNT;
+		shm_hdr->ring_recs = SHM_RING_RECS;
+		shm_hdr->heartbeat = GetTickCount64();
+		ShmFence();
+		memcpy(shm_hdr->sign, "RCKSHM", 7); //solvers check it last
 	}
-	SetRndSeed(GetTickCount64());
-
+	gTargets[0] = PntToSolve;
+	gTargetSolved[0] = false;
+	gTargetCnt = 1;
 	Int_HalfRange.Set(1);
-	Int_HalfRange.ShiftLeft(Range - 1);
-	Pnt_HalfRange = ec.MultiplyG(Int_HalfRange);
-	Pnt_NegHalfRange = Pnt_HalfRange;
-	Pnt_NegHalfRange.y.NegModP();
-	Int_TameOffset.Set(1);
-	Int_TameOffset.ShiftLeft(Range - 1);
-	EcInt tt;
-	tt.Set(1);
-	tt.ShiftLeft(Range - 5); //half of tame range width
-	Int_TameOffset.Sub(tt);
-	gPntToSolve = PntToSolve;
-
-	//prepare GPUs
-	for (int i = 0; i < GpuCnt; i++)
-		if (!GpuKangs[i]->Prepare(PntToSolve, Range, DP, EcJumps1, EcJumps2, EcJumps3))
+	Int_HalfRange.ShiftLeft(gRange - 1);
+	memset(&gServerHello, 0, sizeof(gServerHello));
+	memcpy(gServerHello.sign, "RCKNET", 7);
+	gServerHello.version = NET_VERSION;
+	gServerHello.range = gRange;
+	gServerHello.dp = gDP;
+	PntToSolve.SaveToBuffer64(gServerHello.pnt);
+	gServerJumpHashSet = false;
+	gServerExit = false;
+	PntTotalOps = 0;
+	gGpuDP = gDP;
+	gDPExtMask = 0;
+	if (gTamesFileName[0])
+	{
+		//tames are loaded once for all clients, so clients must use jumps of the tames
+		MakeJumps(gRange);
+		gSessionRange = gRange;
+		gSessionDP = gDP;
+		LoadTames();
+		gDPExtMask = gTamesExtMask;
+		if (db.GetBlockCnt())
 		{
-			GpuKangs[i]->Failed = true;
-			printf("GPU %d Prepare failed\r\n", GpuKangs[i]->CudaIndex);
+			gServerHello.jump_hash = gJumpHash;
+			gServerJumpHashSet = true;
 		}
-
-	u64 tm0 = GetTickCount64();
-	printf("GPUs started...\r\n");
+	}
+	//clients switch to DP of tames, it can differ from -dp
+	gServerHello.gpu_dp = gGpuDP;
+	gServerHello.dp_ext_mask = gDPExtMask;
+	if (gShardCnt > 1)
+		printf("Shard %d of %d: X prefixes %02X..%02X\r\n", gShardIndex, gShardCnt, (gShardIndex * 256 + gShardCnt - 1) / gShardCnt, ((gShardIndex + 1) * 256 + gShardCnt - 1) / gShardCnt - 1);
+	if (gServerPort)
+		printf("Range %d bits, DP %d, listening on port %d...\r\n", gRange, gDP, gServerPort);
+	if (gShmServerName[0])
+		printf("Range %d bits, DP %d, local processes use shared memory %s (%d slots)...\r\n", gRange, gDP, gShmServerName, SHM_SLOT_CNT);
 
 #ifdef _WIN32
-	HANDLE thr_handles[MAX_GPU_CNT];
-#else
-	pthread_t thr_handles[MAX_GPU_CNT];
-#endif
-
 	u32 ThreadID;
+#endif
 	gSolved = false;
-	ThrCnt = GpuCnt;
-	for (int i = 0; i < GpuCnt; i++)
-	{
+	gCollisionThrStop = false;
+	CollisionList.clear();
 #ifdef _WIN32
-		thr_handles[i] = (HANDLE)_beginthreadex(NULL, 0, kang_thr_proc, (void*)GpuKangs[i], 0, &ThreadID);
+	HANDLE coll_thr_handle = (HANDLE)_beginthreadex(NULL, 0, collision_thr_proc, NULL, 0, &ThreadID);
 #else
-		pthread_create(&thr_handles[i], NULL, kang_thr_proc, (void*)GpuKangs[i]);
+	pthread_t coll_thr_handle;
+	pthread_create(&coll_thr_handle, NULL, collision_thr_proc, NULL);
 #endif
-	}
-
-	u64 tm_stats = GetTickCount64();
+	std::vector <TNetClient*> clients;
+	u64 tm_start = GetTickCount64();
+	u64 tm_stats = tm_start;
+	u64 last_dps = 0;
 	while (!gSolved)
 	{
-		CheckNewPoints();
-		Sleep(10);
-		if (GetTickCount64() - tm_stats > 10 * 1000)
+		int wait_ms = 10;
+		if (gShmServerName[0])
+			wait_ms = ShmServerPoll(shm, shm_cls, shm_buf) ? 0 : 1;
+		if (!gServerPort)
+			Sleep(wait_ms);
+		if (gServerPort && (listener.WaitRead(wait_ms) > 0))
 		{
-			ShowStats(tm0, ops, dp_val);
-			tm_stats = GetTickCount64();
+			TNetClient* cl = new TNetClient();
+			cl->active = true;
+			cl->dps = 0;
+			cl->ops = 0;
+			if (listener.Accept(&cl->sock, cl->name))
+			{
+				clients.push_back(cl);
+#ifdef _WIN32
+				cl->thr = (HANDLE)_beginthreadex(NULL, 0, net_client_thr_proc, cl, 0, &ThreadID);
+#else
+				pthread_create(&cl->thr, NULL, net_client_thr_proc, cl);
+#endif
+			}
+			else
+				delete cl;
 		}
-
-		if ((MaxTotalOps > 0.0) && (PntTotalOps > MaxTotalOps))
+		if (gRamLimit > 0)
 		{
-			gIsOpsLimit = true;
-			printf("Operations limit reached\r\n");
-			break;
+			csServer.Enter();
+			CheckDbMemory(gGpuDP);
+			csServer.Leave();
+		}
+		if (GetTickCount64() - tm_stats > 10 * 1000)
+		{
+			int active = 0;
+			u64 dps = 0;
+			csServer.Enter();
+			for (size_t i = 0; i < clients.size(); i++)
+			{
+				active += clients[i]->active;
+				dps += clients[i]->dps;
+			}
+			for (int i = 0; i < SHM_SLOT_CNT; i++)
+			{
+				active += shm_cls[i].state == SHM_SLOT_ACTIVE;
+				dps += shm_cls[i].dps;
+			}
+			u64 rec_cnt = db.GetBlockCnt();
+			u64 ops = PntTotalOps;
+			csServer.Leave();
+			u64 tm = GetTickCount64();
+			double K = (double)ops / pow(2.0, gRange / 2.0);
+			printf("Server: clients %d, DPs received %llu (%.3f M/s), DB %llu, ops 2^%.3f, K %.3f, time %llu s\r\n",
+				active, dps, (dps - last_dps) / ((tm - tm_stats) * 1000.0), rec_cnt, log2((double)ops + 1), K, (tm - tm_start) / 1000);
+			last_dps = dps;
+			tm_stats = tm;
 		}
 	}
-
-	printf("Stopping work ...\r\n");
-	for (int i = 0; i < GpuCnt; i++)
-		GpuKangs[i]->Stop();
-	while (ThrCnt)
-		Sleep(10);
-	for (int i = 0; i < GpuCnt; i++)
+	//send the key to all clients so they stop
+	u8 pk_buf[32];
+	memcpy(pk_buf, gTargetKeys[0].data, 32);
+	for (size_t i = 0; i < clients.size(); i++)
+		if (clients[i]->active)
+			clients[i]->sock.SendMsg(NET_MSG_STOP, pk_buf, 32);
+	if (gShmServerName[0])
+	{
+		TShmHeader* shm_hdr = (TShmHeader*)shm.GetData();
+		memcpy(shm_hdr->key, pk_buf, 32);
+		ShmFence();
+		shm_hdr->solved = 1;
+	}
+	gServerExit = true;
+	for (size_t i = 0; i < clients.size(); i++)
 	{
 #ifdef _WIN32
-		CloseHandle(thr_handles[i]);
+		WaitForSingleObject(clients[i]->thr, INFINITE);
+		CloseHandle(clients[i]->thr);
 #else
-		pthread_join(thr_handles[i], NULL);
+		pthread_join(clients[i]->thr, NULL);
 #endif
+		delete clients[i];
 	}
+	gCollisionThrStop = true;
+#ifdef _WIN32
+	WaitForSingleObject(coll_thr_handle, INFINITE);
+	CloseHandle(coll_thr_handle);
+#else
+	pthread_join(coll_thr_handle, NULL);
+#endif
+	listener.Close();
+	shm.Close(); //solvers keep their mapping until they see the key
 
-	if (gIsOpsLimit)
+	EcInt pk_found = gTargetKeys[0];
+	pk_found.AddModP(gStart);
+	EcPoint tmp = ec.MultiplyG(pk_found);
+	if (!tmp.IsEqual(gPubKey))
 	{
-		if (gGenMode)
-		{
-			printf("saving tames...\r\n");
-			db.Header[0] = gRange;
-			if (db.SaveToFile(gTamesFileName))
-				printf("tames saved\r\n");
-			else
-				printf("tames saving failed\r\n");
-		}
-		db.Clear();
-		return false;
+		printf("FATAL ERROR: server found incorrect key\r\n");
+		return;
 	}
+	if (!gShardIndex) //clients report ops to the first shard only
+		printf("Point solved, K: %.3f (with DP and GPU overheads)\r\n", (double)PntTotalOps / pow(2.0, gRange / 2.0));
+	SaveKey(pk_found);
+}
 
-	double K = (double)PntTotalOps / pow(2.0, Range / 2.0);
-	printf("Point solved, K: %.3f (with DP and GPU overheads)\r\n\r\n", K);
-	db.Clear();
-	*pk_res = gPrivKey;
-	return true;
+volatile bool gTamesServerStop;
+
+void TamesServerSignal(int sig)
+{
+	gTamesServerStop = true;
 }
 
 /**
- * @brief Parses the command line arguments.
+ * @brief Tames service mode: loads tames file once and answers lookups of local solvers ("-tames-service") through shared memory.
  *
- * @param argc The number of arguments.
- * @param argv The argument values.
- * @return true If the arguments are valid.
- * @return false Otherwise.
+ * Runs until Ctrl+C or SIGTERM, then removes shared memory. Solvers detect stopped service by heartbeat.
  */
-
-bool ParseCommandLine(int argc, char* argv[])
+void RunTamesServer()
 {
-	int ci = 1;
-	while (ci < argc)
+	printf("\r\nTAMES SERVICE MODE\r\n\r\n");
+	TDbFileHeader hdr;
+	FILE* fp = fopen(gTamesFileName, "rb");
+	bool ok = fp && (fread(&hdr, 1, sizeof(hdr), fp) == sizeof(hdr));
+	if (fp)
+		fclose(fp);
+	if (!ok || memcmp(hdr.sign, "RCKDBFL", 8) || (hdr.version != DB_FILE_VERSION) || (hdr.kind != DB_FILE_TAMES))
 	{
-		char* argument = argv[ci];
-		ci++;
-		if (strcmp(argument, "-gpu") == 0)
+		printf("error: %s is not a tames file with header, old tames files cannot be used by tames service\r\n", gTamesFileName);
+		return;
+	}
+	if (!db.SetAllocMode(gDbHugeMode, gDbNumaMode))
+		return;
+	u32 load_mask = gTamesDP ? TamesDPMask(&hdr) : 0;
+	printf("load tames...\r\n");
+	if (!db.LoadFromFile(gTamesFileName, load_mask))
+	{
+		printf("error: tames loading failed\r\n");
+		return;
+	}
+	if (load_mask)
+	{
+		//solvers see the filtered set
+		hdr.dp_ext_bits = gTamesDP - hdr.dp;
+		hdr.rec_cnt = db.GetBlockCnt();
+	}
+	printf("tames loaded: %llu DPs, range %d, DP %d, ops: 2^%.3f\r\n", db.GetBlockCnt(), hdr.range, hdr.dp + hdr.dp_ext_bits, log2((double)hdr.total_ops + 1));
+	ShmRegion shm;
+	if (!shm.Create(gTamesServerName, SHM_TAMES_TOTAL_SIZE))
+	{
+		printf("error: cannot create shared memory %s\r\n", gTamesServerName);
+		return;
+	}
+	TShmTamesHeader* shdr = (TShmTamesHeader*)shm.GetData();
+	TShmTamesSlot* slots = (TShmTamesSlot*)(shm.GetData() + sizeof(TShmTamesHeader));
+	shdr->version = SHM_TAMES_VERSION;
+	shdr->slot_cnt = SHM_SLOT_CNT;
+	shdr->batch = SHM_TAMES_BATCH;
+	memcpy(shdr->file_hdr, &hdr, sizeof(hdr));
+	shdr->heartbeat = GetTickCount64();
+	ShmFence();
+	memcpy(shdr->sign, "RCKTMS", 7); //solvers check it last
+	printf("Tames service %s is ready (%d slots)\r\n", gTamesServerName, SHM_SLOT_CNT);
+	gTamesServerStop = false;
+	signal(SIGINT, TamesServerSignal);
+	signal(SIGTERM, TamesServerSignal);
+
+	u32 states[SHM_SLOT_CNT];
+	u64 states_tm[SHM_SLOT_CNT]; //when state was changed
+	memset(states, 0, sizeof(states));
+	memset(states_tm, 0, sizeof(states_tm));
+	u64 lookups = 0;
+	u64 hits = 0;
+	u64 last_lookups = 0;
+	u64 tm_stats = GetTickCount64();
+	while (!gTamesServerStop)
+	{
+		u64 tm = GetTickCount64();
+		shdr->heartbeat = tm;
+		bool idle = true;
+		int active = 0;
+		for (int i = 0; i < SHM_SLOT_CNT; i++)
 		{
-			if (ci >= argc)
+			TShmTamesSlot* slot = &slots[i];
+			u32 state = slot->state;
+			if (state != states[i])
 			{
-				printf("error: missed value after -gpu option\r\n");
-				return false;
+				if (state == SHM_SLOT_ACTIVE)
+					printf("Local process %u (slot %d) attached\r\n", slot->pid, i);
+				if (state == SHM_SLOT_CLOSED)
+					printf("Local process %u (slot %d) detached\r\n", slot->pid, i);
+				states[i] = state;
+				states_tm[i] = tm;
 			}
-			char* gpus = argv[ci];
-			ci++;
-			memset(gGPUs_Mask, 0, sizeof(gGPUs_Mask));
-			for (int i = 0; i < (int)strlen(gpus); i++)
+			bool dead = ((state == SHM_SLOT_ACTIVE) && (tm - slot->heartbeat > SHM_TIMEOUT)) || ((state == SHM_SLOT_TAKEN) && (tm - states_tm[i] > SHM_TIMEOUT));
+			if ((state == SHM_SLOT_CLOSED) || dead)
 			{
-				if ((gpus[i] < '0') || (gpus[i] > '9'))
-				{
-					printf("error: invalid value for -gpu option\r\n");
-					return false;
-				}
-				gGPUs_Mask[gpus[i] - '0'] = 1;
+				if (state == SHM_SLOT_ACTIVE)
+					printf("Local process %u (slot %d) is not responding, slot is freed\r\n", slot->pid, i);
+				if (ShmCas(&slot->state, state, SHM_SLOT_FREE))
+					states[i] = SHM_SLOT_FREE;
+				continue;
 			}
-		}
-		else
-			if (strcmp(argument, "-dp") == 0)
+			if (state != SHM_SLOT_ACTIVE)
+				continue;
+			active++;
+			u64 seq = slot->req_seq;
+			if (seq == slot->ans_seq)
+				continue;
+			ShmFence(); //request is visible after seq
+			u32 cnt = slot->req_cnt;
+			if (cnt > SHM_TAMES_BATCH)
+				cnt = 0;
+			u8* req = shm.GetData() + SHM_TAMES_REQ_OFFSET(i);
+			u8* ans = shm.GetData() + SHM_TAMES_ANS_OFFSET(i);
+			u32 ans_cnt = 0;
+			for (u32 j = 0; j < cnt; j++)
 			{
-				int val = atoi(argv[ci]);
-				ci++;
-				if ((val < 4) || (val > 60)) // Temp Change to Allow for lower DP to build DP model from various runs over bit ranges for DP alorithm
-				{
-					printf("error: invalid value for -dp option\r\n");
-					return false;
-				}
-				gDP = val;
+				u8* found = db.FindDataBlock(req + j * DB_FULL_REC_LEN);
+				if (!found)
+					continue;
+				*(u32*)(ans + ans_cnt * SHM_TAMES_ANS_LEN) = j;
+				memcpy(ans + ans_cnt * SHM_TAMES_ANS_LEN + 4, found, DB_REC_LEN);
+				ans_cnt++;
 			}
-			else
-				if (strcmp(argument, "-range") == 0)
-				{
-					int val = atoi(argv[ci]);
-					ci++;
-					if ((val < 19) || (val > 160))
-					{
-						printf("error: invalid value for -range option\r\n");
-						return false;
-					}
-					gRange = val;
-				}
-				else
-					if (strcmp(argument, "-start") == 0)
-					{
-						if (!gStart.SetHexStr(argv[ci]))
-						{
-							printf("error: invalid value for -start option\r\n");
-							return false;
-						}
-						ci++;
-						gStartSet = true;
-					}
-					else
-						if (strcmp(argument, "-pubkey") == 0)
-						{
-							if (!gPubKey.SetHexStr(argv[ci]))
-							{
-								printf("error: invalid value for -pubkey option\r\n");
-								return false;
-							}
-							ci++;
-						}
-						else
-							if (strcmp(argument, "-tames") == 0)
-							{
-								strcpy(gTamesFileName, argv[ci]);
-								ci++;
-							}
-							else
-								if (strcmp(argument, "-max") == 0)
-								{
-									double val = atof(argv[ci]);
-									ci++;
-									if (val < 0.00001)
-									{
-										printf("error: invalid value for -max option\r\n");
-										return false;
-									}
-									gMax = val;
-								}
-								else
-								{
-									printf("error: unknown option %s\r\n", argument);
-									return false;
-								}
-	}
-	if (!gPubKey.x.IsZero())
-		if (!gStartSet || !gRange || !gDP)
-		{
-			printf("error: you must also specify -dp, -range and -start options\r\n");
-			return false;
+			slot->ans_cnt = ans_cnt;
+			ShmFence(); //answer must be visible before seq
+			slot->ans_seq = seq;
+			lookups += cnt;
+			hits += ans_cnt;
+			idle = false;
 		}
-	if (gTamesFileName[0] && !IsFileExist(gTamesFileName))
-	{
-		if (gMax == 0.0)
+		if (idle)
+			Sleep(1);
+		if (tm - tm_stats > 10 * 1000)
 		{
-			printf("error: you must also specify -max option to generate tames\r\n");
-			return false;
+			printf("Tames service: processes %d, lookups %llu (%.3f M/s), hits %llu\r\n", active, lookups, (lookups - last_lookups) / ((tm - tm_stats) * 1000.0), hits);
+			last_lookups = lookups;
+			tm_stats = tm;
 		}
-		gGenMode = true;
 	}
-	return true;
+	signal(SIGINT, SIG_DFL);
+	signal(SIGTERM, SIG_DFL);
+	shdr->heartbeat = 0; //solvers stop waiting for answers at once
+	ShmFence();
+	shm.Close(); //owner removes the name, solvers keep their mapping until they close it
+	printf("Tames service %s stopped\r\n", gTamesServerName);
 }
 
 /**
@@ -1017,28 +4221,143 @@ int main(int argc, char* argv[])
 	gRange = 0;
 	gStartSet = false;
 	gTamesFileName[0] = 0;
+	gPubKeysFileName[0] = 0;
+	gJobsFileName[0] = 0;
+	gResultsFileName[0] = 0;
+	gBenchDpMin = 0;
+	gDpAuto = false;
+	gRamLimit = 0.0;
+	gDPExtMask = 0;
+	gJumpSeed = 0;
+	gCheckpointFileName[0] = 0;
+	gCheckpointInterval = 10;
+	gResume = false;
+	gJournalSync = 0;
+	gTamesExtend = false;
+	gWildsFileName[0] = 0;
+	gServerPort = 0;
+	gServerCnt = 0;
+	gShmServerName[0] = 0;
+	gShmClientName[0] = 0;
+	gShmSlot = -1;
+	gTamesServerName[0] = 0;
+	gTamesServiceName[0] = 0;
+	gTamesSlot = -1;
+	gShardIndex = 0;
+	gShardCnt = 1;
 	gMax = 0.0;
 	gGenMode = false;
 	gIsOpsLimit = false;
 	memset(gGPUs_Mask, 1, sizeof(gGPUs_Mask));
+	gDbBenchCnt = 0;
+	gWireBenchCnt = 0;
+	gTamesMergeFiles.clear();
+	gTamesOutFileName[0] = 0;
+	gTamesDP = 0;
+	gTamesVerify = 0;
+	gNodeId = 0;
+	gNodeCnt = 0;
+	gNodeEpoch = 0;
+	gDbHugeMode = DB_HUGE_NONE;
+	gDbNumaMode = DB_NUMA_NONE;
 	if (!ParseCommandLine(argc, argv))
 		return 0;
 
+	if (gDbBenchCnt)
+	{
+		BenchDb(gDbBenchCnt, gDbHugeMode, gDbNumaMode);
+		DeInitEc();
+		return 0;
+	}
+	if (gWireBenchCnt)
+	{
+		BenchWire(gWireBenchCnt, gRange ? gRange : 78);
+		DeInitEc();
+		return 0;
+	}
+	if (!gTamesMergeFiles.empty())
+	{
+		TamesMerge(gTamesMergeFiles, gTamesOutFileName);
+		DeInitEc();
+		return 0;
+	}
+	if (gTamesOutFileName[0])
+	{
+		TamesDownsample(gTamesFileName, gTamesOutFileName, gTamesDP);
+		DeInitEc();
+		return 0;
+	}
+	if (gTamesVerify)
+	{
+		TamesVerify(gTamesFileName, gTamesVerify);
+		DeInitEc();
+		return 0;
+	}
+	if (gServerPort || gShmServerName[0])
+	{
+		RunServer();
+		DeInitEc();
+		return 0;
+	}
+	if (gTamesServerName[0])
+	{
+		RunTamesServer();
+		DeInitEc();
+		return 0;
+	}
+	if (gServerCnt && !NetInit())
+		return 0;
+
 	InitGpus();
 
+	if (!GpuCnt && gGenMode)
+	{
+		RunCpuTamesGen();
+		DeInitEc();
+		return 0;
+	}
 	if (!GpuCnt)
 	{
 		printf("No supported GPUs detected, exit\r\n");
 		return 0;
 	}
+	for (int i = 0; i < GpuCnt; i++)
+		GpuKangs[i]->SetNode(gNodeId, gNodeCnt, gNodeEpoch, i);
+	if (gNodeCnt)
+		printf("Node %d of %d, epoch %llu: kangs are derived from node index\r\n", gNodeId, gNodeCnt, gNodeEpoch);
+	if (!db.SetAllocMode(gDbHugeMode, gDbNumaMode))
+		return 0;
+	if (gDpAuto)
+	{
+		gDbRecCost = MeasureDbRecCost(&db, DP_AUTO_SAMPLE_CNT, &gDbFixedBytes);
+		printf("DB memory: %.2f bytes per record (measured), %.3f GB fixed\r\n", gDbRecCost, (double)gDbFixedBytes / (1024 * 1024 * 1024));
+	}
 
 	pPntList = (u8*)malloc(MAX_CNT_LIST * GPU_DP_SIZE);
 	pPntList2 = (u8*)malloc(MAX_CNT_LIST * GPU_DP_SIZE);
 	TotalOps = 0;
 	TotalSolved = 0;
 	gTotalErrors = 0;
-	IsBench = gPubKey.x.IsZero();
+	gCollisionsChecked = 0;
+	gMirrorCollisions = 0;
+	gFalseMatches = 0;
+	IsBench = gPubKey.x.IsZero() && !gPubKeysFileName[0] && !gJobsFileName[0];
 
+	if (gPubKeysFileName[0] && !gGenMode)
+	{
+		SolvePubKeys();
+		goto label_end;
+	}
+	if (gJobsFileName[0] && !gGenMode)
+	{
+		RunJobs();
+		goto label_end;
+	}
+	if (gBenchDpMin)
+	{
+		RunDpSweep();
+		goto label_end;
+	}
 	if (!IsBench && !gGenMode)
 	{
 		printf("\r\nMAIN MODE\r\n\r\n");
@@ -1074,21 +4393,7 @@ int main(int argc, char* argv[])
 			goto label_end;
 		}
 		//happy end
-		char s[100];
-		pk_found.GetHexStr(s);
-		printf("\r\nPRIVATE KEY: %s\r\n\r\n", s);
-		FILE* fp = fopen("RESULTS.TXT", "a");
-		if (fp)
-		{
-			fprintf(fp, "PRIVATE KEY: %s\n", s);
-			fclose(fp);
-		}
-		else //we cannot save the key, show error and wait forever so the key is displayed
-		{
-			printf("WARNING: Cannot save the key to RESULTS.TXT!\r\n");
-			while (1)
-				Sleep(100);
-		}
+		SaveKey(pk_found);
 	}
 	else
 	{
@@ -1097,6 +4402,7 @@ int main(int argc, char* argv[])
 		else
 			printf("\r\nBENCHMARK MODE\r\n");
 		//solve points, show K
+		u64 tm_bench = GetTickCount64();
 		while (1)
 		{
 			EcInt pk, pk_found;
@@ -1104,7 +4410,7 @@ int main(int argc, char* argv[])
 
 			if (!gRange)
 				gRange = 78;
-			if (!gDP)
+			if (!gDP && !gDpAuto)
 				gDP = 16;
 
 			//generate random pk
@@ -1126,11 +4432,14 @@ int main(int argc, char* argv[])
 			TotalSolved++;
 			u64 ops_per_pnt = TotalOps / TotalSolved;
 			double K = (double)ops_per_pnt / pow(2.0, gRange / 2.0);
-			printf("Points solved: %d, average K: %.3f (with DP and GPU overheads)\r\n", TotalSolved, K);
+			double mins = (GetTickCount64() - tm_bench) / 60000.0;
+			printf("Points solved: %d, average K: %.3f (with DP and GPU overheads), %.2f solves/min\r\n", TotalSolved, K, TotalSolved / mins);
 			//if (TotalSolved >= 100) break; //dbg
 		}
 	}
 label_end:
+	ShmClientClose();
+	EndSession();
 	for (int i = 0; i < GpuCnt; i++)
 		delete GpuKangs[i];
 	DeInitEc();
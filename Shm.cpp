@@ -0,0 +1,208 @@
+// Shm.cpp
+//
+// This file is a part of RCKangaroo software
+// (c) 2024, RetiredCoder (RC)
+// License: GPLv3, see "LICENSE.TXT" file
+// https://github.com/RetiredC
+
+
+#include <atomic>
+#include <stddef.h>
+#include "utils.h"
+#include "Shm.h"
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#endif
+
+bool ShmCas(volatile u32* ptr, u32 old_val, u32 new_val)
+{
+#ifdef _WIN32
+	return (u32)InterlockedCompareExchange((volatile LONG*)ptr, (LONG)new_val, (LONG)old_val) == old_val;
+#else
+	return __sync_bool_compare_and_swap(ptr, old_val, new_val);
+#endif
+}
+
+void ShmFence()
+{
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+u32 ShmGetPid()
+{
+#ifdef _WIN32
+	return GetCurrentProcessId();
+#else
+	return (u32)getpid();
+#endif
+}
+
+ShmRegion::ShmRegion()
+{
+	data = NULL;
+	size = 0;
+	owner = false;
+	name[0] = 0;
+#ifdef _WIN32
+	map = NULL;
+#endif
+}
+
+ShmRegion::~ShmRegion()
+{
+	Close();
+}
+
+bool ShmRegion::Create(char* _name, u64 _size)
+{
+	Close();
+#ifdef _WIN32
+	sprintf(name, "Local\\RCK_%s", _name);
+	map = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE | SEC_RESERVE, (DWORD)(_size >> 32), (DWORD)_size, name);
+	if (!map)
+		return false;
+	if (GetLastError() == ERROR_ALREADY_EXISTS)
+	{
+		CloseHandle(map);
+		map = NULL;
+		return false;
+	}
+	data = (u8*)MapViewOfFile(map, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+	if (!data)
+	{
+		CloseHandle(map);
+		map = NULL;
+		return false;
+	}
+	//SEC_RESERVE: pages are committed once, other processes see the same memory
+	if (!VirtualAlloc(data, _size, MEM_COMMIT, PAGE_READWRITE))
+	{
+		Close();
+		return false;
+	}
+#else
+	sprintf(name, "/rck_%s", _name);
+	if (!RemoveStale())
+		return false;
+	int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+	if (fd < 0)
+		return false;
+	//pages are allocated on first write, so unused rings don't take memory
+	if (ftruncate(fd, _size))
+	{
+		close(fd);
+		shm_unlink(name);
+		return false;
+	}
+	data = (u8*)mmap(NULL, _size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED)
+	{
+		data = NULL;
+		shm_unlink(name);
+		return false;
+	}
+#endif
+	//no memset: O_EXCL (ERROR_ALREADY_EXISTS on Windows) guarantees a new object and new objects are zero-filled by OS,
+	//writing the whole region would commit memory of all rings
+	size = _size;
+	owner = true;
+	return true;
+}
+
+//RemoveStale reads heartbeat of any region through TShmHeader
+static_assert(offsetof(TShmHeader, heartbeat) == offsetof(TShmTamesHeader, heartbeat), "heartbeat offsets of shared memory headers differ");
+
+#ifndef _WIN32
+//region with this name is left by crashed owner if its heartbeat is older than SHM_TIMEOUT, such region is removed.
+//returns false if the owner is alive
+bool ShmRegion::RemoveStale()
+{
+	int fd = shm_open(name, O_RDONLY, 0);
+	if (fd < 0)
+		return true;
+	struct stat st;
+	u64 heartbeat = 0;
+	if (!fstat(fd, &st) && (st.st_size >= (off_t)sizeof(TShmHeader)))
+	{
+		TShmHeader* hdr = (TShmHeader*)mmap(NULL, sizeof(TShmHeader), PROT_READ, MAP_SHARED, fd, 0);
+		if (hdr != MAP_FAILED)
+		{
+			heartbeat = hdr->heartbeat;
+			munmap(hdr, sizeof(TShmHeader));
+		}
+	}
+	close(fd);
+	if (heartbeat && (GetTickCount64() - heartbeat < SHM_TIMEOUT))
+	{
+		printf("shared memory %s is used by running process or its owner stopped less than %d seconds ago\r\n", name + 1, SHM_TIMEOUT / 1000);
+		return false;
+	}
+	shm_unlink(name);
+	return true;
+}
+#endif
+
+bool ShmRegion::Open(char* _name)
+{
+	Close();
+#ifdef _WIN32
+	sprintf(name, "Local\\RCK_%s", _name);
+	map = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, name);
+	if (!map)
+		return false;
+	data = (u8*)MapViewOfFile(map, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+	if (!data)
+	{
+		CloseHandle(map);
+		map = NULL;
+		return false;
+	}
+	MEMORY_BASIC_INFORMATION info;
+	VirtualQuery(data, &info, sizeof(info));
+	size = info.RegionSize;
+#else
+	sprintf(name, "/rck_%s", _name);
+	int fd = shm_open(name, O_RDWR, 0);
+	if (fd < 0)
+		return false;
+	struct stat st;
+	if (fstat(fd, &st) || (st.st_size < (off_t)sizeof(TShmHeader)))
+	{
+		close(fd);
+		return false;
+	}
+	size = st.st_size;
+	data = (u8*)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED)
+	{
+		data = NULL;
+		size = 0;
+		return false;
+	}
+#endif
+	owner = false;
+	return true;
+}
+
+void ShmRegion::Close()
+{
+	if (!data)
+		return;
+#ifdef _WIN32
+	UnmapViewOfFile(data);
+	CloseHandle(map);
+	map = NULL;
+#else
+	munmap(data, size);
+	if (owner)
+		shm_unlink(name);
+#endif
+	data = NULL;
+	size = 0;
+	owner = false;
+}
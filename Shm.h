@@ -0,0 +1,115 @@
+// Shm.h
+//
+// This file is a part of RCKangaroo software
+// (c) 2024, RetiredCoder (RC)
+// License: GPLv3, see "LICENSE.TXT" file
+// https://github.com/RetiredC
+
+
+#pragma once
+
+#include "defs.h"
+#include "Net.h"
+
+//shared memory of "-shm-server" (host-local DP aggregator): TShmHeader, SHM_SLOT_CNT slots, then a ring of DB records for every slot.
+//every solver process takes one slot, its ring has one writer (solver) and one reader (aggregator), so no locks are needed
+#define SHM_VERSION			2
+#define SHM_SLOT_CNT		32
+#define SHM_RING_RECS		(256 * 1024)	//per slot, must be power of 2
+#define SHM_TIMEOUT			(30 * 1000)		//ms without heartbeat, then the other side is dead
+
+#define SHM_SLOT_FREE		0
+#define SHM_SLOT_TAKEN		1	//solver took the slot and fills hello
+#define SHM_SLOT_HELLO		2	//hello is ready to check
+#define SHM_SLOT_ACTIVE		3	//aggregator accepted hello, solver writes DPs
+#define SHM_SLOT_REJECTED	4	//solver must release the slot
+#define SHM_SLOT_CLOSED		5	//solver detached, aggregator reads the rest of the ring and frees the slot
+
+struct TShmHeader
+{
+	char sign[8];
+	u32 version;
+	u32 slot_cnt;
+	u32 ring_recs;
+	volatile u32 solved; //key is valid
+	volatile u64 heartbeat; //aggregator's GetTickCount64, monotonic clock is the same for all processes
+	u8 key[32]; //found key (relative to start)
+	u8 reserved[192];
+};
+
+struct TShmSlot
+{
+	volatile u32 state;
+	u32 pid;
+	TNetHello hello;
+	volatile u64 heartbeat; //solver's GetTickCount64
+	volatile u64 ops; //total ops of solver since hello
+	volatile u64 head; //records written by solver
+	u8 pad1[64];
+	volatile u64 tail; //records read by aggregator, in other cache line
+	u8 pad2[56];
+};
+
+#define SHM_RING_OFFSET(slot)	(sizeof(TShmHeader) + SHM_SLOT_CNT * sizeof(TShmSlot) + (u64)(slot) * SHM_RING_RECS * DB_FULL_REC_LEN)
+#define SHM_TOTAL_SIZE			SHM_RING_OFFSET(SHM_SLOT_CNT)
+
+//shared memory of "-tames-server" (tames lookup service): TShmTamesHeader, SHM_SLOT_CNT slots, then request and answer buffers of every slot.
+//solver writes its wild DPs to request and increments req_seq, service writes tames with the same X to answer and sets ans_seq = req_seq
+#define SHM_TAMES_VERSION	1
+#define SHM_TAMES_BATCH		(64 * 1024)			//max records in one request
+#define SHM_TAMES_ANS_LEN	(4 + DB_REC_LEN)	//index of record in request, then tame record without first DB_KEY_LEN bytes
+
+struct TShmTamesHeader
+{
+	char sign[8];
+	u32 version;
+	u32 slot_cnt;
+	u32 batch;
+	u32 reserved1;
+	volatile u64 heartbeat; //service's GetTickCount64, same offset as in TShmHeader
+	u8 file_hdr[256]; //header of tames file, solvers check range, DP and jumps with it
+	u8 reserved[224];
+};
+
+struct TShmTamesSlot
+{
+	volatile u32 state; //SHM_SLOT_FREE, SHM_SLOT_ACTIVE or SHM_SLOT_CLOSED
+	u32 pid;
+	volatile u64 heartbeat; //solver's GetTickCount64
+	volatile u64 req_seq;
+	volatile u64 ans_seq;
+	volatile u32 req_cnt;
+	volatile u32 ans_cnt;
+	u8 pad[24];
+};
+
+#define SHM_TAMES_REQ_OFFSET(slot)	(sizeof(TShmTamesHeader) + SHM_SLOT_CNT * sizeof(TShmTamesSlot) + (u64)(slot) * SHM_TAMES_BATCH * (DB_FULL_REC_LEN + SHM_TAMES_ANS_LEN))
+#define SHM_TAMES_ANS_OFFSET(slot)	(SHM_TAMES_REQ_OFFSET(slot) + SHM_TAMES_BATCH * DB_FULL_REC_LEN)
+#define SHM_TAMES_TOTAL_SIZE		SHM_TAMES_REQ_OFFSET(SHM_SLOT_CNT)
+
+bool ShmCas(volatile u32* ptr, u32 old_val, u32 new_val);
+void ShmFence();
+u32 ShmGetPid();
+
+//named shared memory: POSIX shm on Linux, file mapping on Windows
+class ShmRegion
+{
+private:
+	u8* data;
+	u64 size;
+	bool owner;
+	char name[256];
+#ifdef _WIN32
+	void* map;
+#else
+	bool RemoveStale();
+#endif
+public:
+	ShmRegion();
+	~ShmRegion();
+	bool Create(char* _name, u64 _size); //old region with the same name is removed if its owner is dead
+	bool Open(char* _name);
+	void Close(); //owner removes the name
+	u8* GetData() { return data; }
+	u64 GetSize() { return size; }
+};
@@ -0,0 +1,1170 @@
+// Tames.cpp
+//
+// This file is a part of RCKangaroo software
+// (c) 2024, RetiredCoder (RC)
+// License: GPLv3, see "LICENSE.TXT" file
+// https://github.com/RetiredC
+
+
+#include <math.h>
+#include <algorithm>
+#include <string>
+#include "Tames.h"
+#include "Ec.h"
+
+#ifdef _WIN32
+#include <io.h>
+#endif
+
+typedef void (*TTamesThrFunc)(void* ctx, int thr_ind);
+
+struct TTamesThr
+{
+	TTamesThrFunc func;
+	void* ctx;
+	int ind;
+};
+
+#ifdef _WIN32
+u32 __stdcall tames_thr_proc(void* data)
+#else
+void* tames_thr_proc(void* data)
+#endif
+{
+	TTamesThr* thr = (TTamesThr*)data;
+	thr->func(thr->ctx, thr->ind);
+	return 0;
+}
+
+//runs func in thr_cnt threads and waits for all of them
+static void TamesRunThreads(TTamesThrFunc func, void* ctx, int thr_cnt)
+{
+	std::vector <TTamesThr> thrs(thr_cnt);
+	std::vector <HHANDLER> handles(thr_cnt);
+	for (int i = 0; i < thr_cnt; i++)
+	{
+		thrs[i].func = func;
+		thrs[i].ctx = ctx;
+		thrs[i].ind = i;
+#ifdef _WIN32
+		handles[i] = (HANDLE)_beginthreadex(NULL, 0, tames_thr_proc, &thrs[i], 0, NULL);
+#else
+		pthread_create(&handles[i], NULL, tames_thr_proc, &thrs[i]);
+#endif
+	}
+	for (int i = 0; i < thr_cnt; i++)
+	{
+#ifdef _WIN32
+		WaitForSingleObject(handles[i], INFINITE);
+		CloseHandle(handles[i]);
+#else
+		pthread_join(handles[i], NULL);
+#endif
+	}
+}
+
+static int TamesCpuCnt()
+{
+#ifdef _WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwNumberOfProcessors;
+#else
+	int cnt = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	return (cnt > 0) ? cnt : 1;
+#endif
+}
+
+static int TamesNextPart(volatile long* next)
+{
+#ifdef _WIN32
+	return InterlockedIncrement(next) - 1;
+#else
+	return __sync_fetch_and_add(next, 1);
+#endif
+}
+
+//reads lists of partitions [part_first, part_first + part_cnt) of tames file, fp must be at the first list of part_first.
+//list_pos gets index of the first record of every list, part_cnt * 256 + 1 values
+static bool TamesReadParts(FILE* fp, int part_cnt, std::vector <u8>& recs, std::vector <u32>& list_pos)
+{
+	int list_cnt = part_cnt * 256;
+	list_pos.resize(list_cnt + 1);
+	recs.resize(0);
+	u32 rec_ind = 0;
+	for (int i = 0; i < list_cnt; i++)
+	{
+		list_pos[i] = rec_ind;
+		u16 cnt;
+		if (fread(&cnt, 1, 2, fp) != 2)
+			return false;
+		if (!cnt)
+			continue;
+		recs.resize((u64)(rec_ind + cnt) * DB_REC_LEN);
+		if (fread(recs.data() + (u64)rec_ind * DB_REC_LEN, DB_REC_LEN, cnt, fp) != cnt)
+			return false;
+		rec_ind += cnt;
+	}
+	list_pos[list_cnt] = rec_ind;
+	return true;
+}
+
+/**
+ * @brief Reads header of tames file and checks that the file is complete.
+ *
+ * Only files with header (DB_FILE_VERSION) are supported.
+ *
+ * @return true If the file can be processed.
+ */
+bool TamesCheckFile(char* fn, TDbFileHeader* hdr)
+{
+	FILE* fp = fopen(fn, "rb");
+	bool ok = fp && (fread(hdr, 1, sizeof(TDbFileHeader), fp) == sizeof(TDbFileHeader));
+	if (fp)
+		fclose(fp);
+	if (!ok)
+	{
+		printf("%s: cannot read file header\r\n", fn);
+		return false;
+	}
+	if (memcmp(hdr->sign, "RCKDBFL", 8) || (hdr->version != DB_FILE_VERSION) || (hdr->kind != DB_FILE_TAMES))
+	{
+		printf("%s: not a tames file with header, old tames files are not supported\r\n", fn);
+		return false;
+	}
+	if ((hdr->key_len != DB_KEY_LEN) || (hdr->rec_len != DB_REC_LEN))
+	{
+		printf("%s: file has different record layout\r\n", fn);
+		return false;
+	}
+	if (GetFileLen(fn) != sizeof(TDbFileHeader) + 2ull * 256 * 256 * 256 + hdr->rec_cnt * DB_REC_LEN)
+	{
+		printf("%s: file size doesn't match header, file is truncated or corrupted\r\n", fn);
+		return false;
+	}
+	return true;
+}
+
+struct TMergeInput
+{
+	char* fn;
+	FILE* fp;
+	TDbFileHeader hdr;
+	std::vector <u8> recs;
+	std::vector <u32> list_pos;
+	bool ok;
+};
+
+struct TMergeCtx
+{
+	std::vector <TMergeInput> ins;
+	int part_cnt; //partitions in current block
+	volatile long next_part;
+	std::vector <std::vector <u8> > outs; //merged partitions in file format
+	std::vector <u64> dup_cnt; //per thread
+	std::vector <u64> drop_cnt;
+};
+
+static void merge_read_proc(void* data, int thr_ind)
+{
+	TMergeCtx* ctx = (TMergeCtx*)data;
+	TMergeInput* in = &ctx->ins[thr_ind];
+	in->ok = TamesReadParts(in->fp, ctx->part_cnt, in->recs, in->list_pos);
+}
+
+//k-way merge of every list of the partition, records with the same X are written once
+static void merge_proc(void* data, int thr_ind)
+{
+	TMergeCtx* ctx = (TMergeCtx*)data;
+	int in_cnt = (int)ctx->ins.size();
+	std::vector <u32> heads(in_cnt);
+	while (1)
+	{
+		int part = TamesNextPart(&ctx->next_part);
+		if (part >= ctx->part_cnt)
+			break;
+		u64 len = 0;
+		for (int i = 0; i < in_cnt; i++)
+			len += (u64)(ctx->ins[i].list_pos[(part + 1) * 256] - ctx->ins[i].list_pos[part * 256]) * DB_REC_LEN;
+		std::vector <u8>& out = ctx->outs[part];
+		out.resize(256 * 2 + len);
+		u8* p = out.data();
+		for (int l = part * 256; l < (part + 1) * 256; l++)
+		{
+			u16* cnt_ptr = (u16*)p;
+			p += 2;
+			u32 cnt = 0;
+			u8* last = NULL;
+			for (int i = 0; i < in_cnt; i++)
+				heads[i] = ctx->ins[i].list_pos[l];
+			while (1)
+			{
+				int best = -1;
+				u8* best_rec = NULL;
+				for (int i = 0; i < in_cnt; i++)
+					if (heads[i] < ctx->ins[i].list_pos[l + 1])
+					{
+						u8* rec = ctx->ins[i].recs.data() + (u64)heads[i] * DB_REC_LEN;
+						if ((best < 0) || (memcmp(rec, best_rec, DB_FIND_LEN) < 0))
+						{
+							best = i;
+							best_rec = rec;
+						}
+					}
+				if (best < 0)
+					break;
+				heads[best]++;
+				if (last && !memcmp(last, best_rec, DB_FIND_LEN))
+				{
+					ctx->dup_cnt[thr_ind]++;
+					continue;
+				}
+				if (cnt == 0xFFFF)
+				{
+					ctx->drop_cnt[thr_ind]++; //list is full, DB has the same limit
+					continue;
+				}
+				memcpy(p, best_rec, DB_REC_LEN);
+				last = p;
+				p += DB_REC_LEN;
+				cnt++;
+			}
+			*cnt_ptr = (u16)cnt;
+		}
+		out.resize(p - out.data());
+	}
+}
+
+/**
+ * @brief Merges tames files made with the same range, DP and jumps into one file.
+ *
+ * Files are read in key order by blocks of partitions, every block is merged in parallel and written, so memory is limited by TAMES_MEM_LIMIT.
+ *
+ * @param in_files Tames files to merge.
+ * @param out_file Output file, ops of all inputs are summed in its header.
+ * @return true If the output file is written.
+ */
+bool TamesMerge(std::vector <char*>& in_files, char* out_file)
+{
+	TMergeCtx ctx;
+	int in_cnt = (int)in_files.size();
+	ctx.ins.resize(in_cnt);
+	u64 in_recs = 0;
+	u64 in_bytes = 0;
+	for (int i = 0; i < in_cnt; i++)
+	{
+		TMergeInput* in = &ctx.ins[i];
+		in->fn = in_files[i];
+		in->fp = NULL;
+		if (!TamesCheckFile(in->fn, &in->hdr))
+			return false;
+		TDbFileHeader* h0 = &ctx.ins[0].hdr;
+		if ((in->hdr.range != h0->range) || (in->hdr.dp != h0->dp) || (in->hdr.dp_ext_bits != h0->dp_ext_bits) ||
+			(in->hdr.jmp_cnt != h0->jmp_cnt) || (in->hdr.jump_seed != h0->jump_seed) || (in->hdr.jump_hash != h0->jump_hash))
+		{
+			printf("%s: range, DP or jumps are different from %s, files cannot be merged\r\n", in->fn, ctx.ins[0].fn);
+			return false;
+		}
+		in_recs += in->hdr.rec_cnt;
+		in_bytes += GetFileLen(in->fn);
+	}
+	for (int i = 0; i < in_cnt; i++)
+	{
+		ctx.ins[i].fp = fopen(ctx.ins[i].fn, "rb");
+		if (ctx.ins[i].fp)
+		{
+			setvbuf(ctx.ins[i].fp, NULL, _IOFBF, 4 * 1024 * 1024);
+			fseek(ctx.ins[i].fp, sizeof(TDbFileHeader), SEEK_SET);
+		}
+	}
+	FILE* fout = fopen(out_file, "wb");
+	bool res = (fout != NULL);
+	for (int i = 0; i < in_cnt; i++)
+		res = res && ctx.ins[i].fp;
+	if (!res)
+		printf("error: cannot open files for merge\r\n");
+
+	TDbFileHeader hdr = ctx.ins[0].hdr;
+	hdr.total_ops = 0;
+	hdr.gpu_cnt = 0;
+	hdr.kang_cnt = 0;
+	for (int i = 0; i < in_cnt; i++)
+	{
+		hdr.total_ops += ctx.ins[i].hdr.total_ops;
+		hdr.gpu_cnt += ctx.ins[i].hdr.gpu_cnt;
+		hdr.kang_cnt += ctx.ins[i].hdr.kang_cnt;
+	}
+	hdr.rec_cnt = 0;
+	if (res)
+	{
+		setvbuf(fout, NULL, _IOFBF, 4 * 1024 * 1024);
+		res = fwrite(&hdr, 1, sizeof(hdr), fout) == sizeof(hdr);
+	}
+
+	//block size: buffers of all inputs and outputs fit in TAMES_MEM_LIMIT
+	double part_bytes = (double)in_bytes / TAMES_PART_CNT;
+	int block_parts = (int)(TAMES_MEM_LIMIT / (2 * part_bytes + 1));
+	if (block_parts < 1)
+		block_parts = 1;
+	if (block_parts > TAMES_PART_CNT)
+		block_parts = TAMES_PART_CNT;
+	int thr_cnt = TamesCpuCnt();
+	ctx.dup_cnt.assign(thr_cnt, 0);
+	ctx.drop_cnt.assign(thr_cnt, 0);
+	printf("merging %d files, %llu records, %d threads...\r\n", in_cnt, in_recs, thr_cnt);
+	u64 tm_start = GetTickCount64();
+	u64 tm_stats = tm_start;
+	for (int part = 0; res && (part < TAMES_PART_CNT); part += block_parts)
+	{
+		ctx.part_cnt = (block_parts < TAMES_PART_CNT - part) ? block_parts : TAMES_PART_CNT - part;
+		TamesRunThreads(merge_read_proc, &ctx, in_cnt);
+		for (int i = 0; i < in_cnt; i++)
+			if (!ctx.ins[i].ok)
+			{
+				printf("%s: read error\r\n", ctx.ins[i].fn);
+				res = false;
+			}
+		if (!res)
+			break;
+		ctx.outs.resize(ctx.part_cnt);
+		ctx.next_part = 0;
+		TamesRunThreads(merge_proc, &ctx, thr_cnt);
+		for (int i = 0; i < ctx.part_cnt; i++)
+		{
+			std::vector <u8>& out = ctx.outs[i];
+			hdr.rec_cnt += (out.size() - 256 * 2) / DB_REC_LEN;
+			if (fwrite(out.data(), 1, out.size(), fout) != out.size())
+			{
+				printf("error: cannot write %s\r\n", out_file);
+				res = false;
+				break;
+			}
+		}
+		if (GetTickCount64() - tm_stats > 10 * 1000)
+		{
+			printf("merged %.1f%%\r\n", 100.0 * (part + ctx.part_cnt) / TAMES_PART_CNT);
+			tm_stats = GetTickCount64();
+		}
+	}
+	if (res)
+	{
+		fseek(fout, 0, SEEK_SET);
+		res = (fwrite(&hdr, 1, sizeof(hdr), fout) == sizeof(hdr)) && !fflush(fout);
+	}
+	for (int i = 0; i < in_cnt; i++)
+		if (ctx.ins[i].fp)
+			fclose(ctx.ins[i].fp);
+	if (fout)
+		fclose(fout);
+	if (!res)
+		return false;
+	u64 dups = 0, drops = 0;
+	for (int i = 0; i < thr_cnt; i++)
+	{
+		dups += ctx.dup_cnt[i];
+		drops += ctx.drop_cnt[i];
+	}
+	double sec = (GetTickCount64() - tm_start) / 1000.0 + 0.001;
+	printf("merged into %s: %llu records, %llu duplicates removed, %llu dropped (full lists), ops: 2^%.3f\r\n", out_file, hdr.rec_cnt, dups, drops, log2((double)hdr.total_ops + 1));
+	printf("time %.1f s, %.1f MB/s\r\n", sec, in_bytes / sec / (1024 * 1024));
+	return true;
+}
+
+/**
+ * @brief Writes records of tames file that are DPs for higher DP to a new file.
+ *
+ * GPU DP of the file is kept, extra DP bits are checked in x[1] like gDPExtMask, so dp_ext_bits of the header is raised.
+ *
+ * @param in_file Tames file.
+ * @param out_file Output file.
+ * @param dp New DP, higher than DP of the file.
+ * @return true If the output file is written.
+ */
+bool TamesDownsample(char* in_file, char* out_file, int dp)
+{
+	TDbFileHeader hdr;
+	if (!TamesCheckFile(in_file, &hdr))
+		return false;
+	int file_dp = hdr.dp + hdr.dp_ext_bits;
+	if ((dp <= file_dp) || (dp - hdr.dp > 32))
+	{
+		printf("error: DP of %s is %d, new DP must be higher and not more than %d\r\n", in_file, file_dp, hdr.dp + 32);
+		return false;
+	}
+	u32 ext_mask = (u32)((1ull << (dp - hdr.dp)) - 1);
+	FILE* fin = fopen(in_file, "rb");
+	FILE* fout = fopen(out_file, "wb");
+	if (!fin || !fout)
+	{
+		printf("error: cannot open files\r\n");
+		if (fin)
+			fclose(fin);
+		if (fout)
+			fclose(fout);
+		return false;
+	}
+	setvbuf(fin, NULL, _IOFBF, 4 * 1024 * 1024);
+	setvbuf(fout, NULL, _IOFBF, 4 * 1024 * 1024);
+	u64 in_recs = hdr.rec_cnt;
+	hdr.dp_ext_bits = dp - hdr.dp;
+	hdr.rec_cnt = 0;
+	bool res = (fseek(fin, sizeof(TDbFileHeader), SEEK_SET) == 0) && (fwrite(&hdr, 1, sizeof(hdr), fout) == sizeof(hdr));
+	printf("downsampling %s from DP %d to DP %d...\r\n", in_file, file_dp, dp);
+	u64 tm_start = GetTickCount64();
+	u8* buf = (u8*)malloc(0xFFFF * DB_REC_LEN);
+	for (int i = 0; res && (i < 256 * 256 * 256); i++)
+	{
+		u16 cnt;
+		if ((fread(&cnt, 1, 2, fin) != 2) || (cnt && (fread(buf, DB_REC_LEN, cnt, fin) != cnt)))
+		{
+			printf("%s: read error\r\n", in_file);
+			res = false;
+			break;
+		}
+		u16 new_cnt = 0;
+		for (int m = 0; m < cnt; m++)
+			if (!(*(u32*)(buf + m * DB_REC_LEN + 8 - DB_KEY_LEN) & ext_mask))
+				memmove(buf + (new_cnt++) * DB_REC_LEN, buf + m * DB_REC_LEN, DB_REC_LEN);
+		hdr.rec_cnt += new_cnt;
+		if ((fwrite(&new_cnt, 1, 2, fout) != 2) || (fwrite(buf, DB_REC_LEN, new_cnt, fout) != new_cnt))
+		{
+			printf("error: cannot write %s\r\n", out_file);
+			res = false;
+		}
+	}
+	free(buf);
+	if (res)
+	{
+		fseek(fout, 0, SEEK_SET);
+		res = (fwrite(&hdr, 1, sizeof(hdr), fout) == sizeof(hdr)) && !fflush(fout);
+	}
+	fclose(fin);
+	fclose(fout);
+	if (!res)
+		return false;
+	double sec = (GetTickCount64() - tm_start) / 1000.0 + 0.001;
+	printf("saved %s: %llu of %llu records (%.2f%%), DP %d, time %.1f s\r\n", out_file, hdr.rec_cnt, in_recs, 100.0 * hdr.rec_cnt / (in_recs + !in_recs), dp, sec);
+	return true;
+}
+
+#define TAMES_D_LEN			((int)sizeof(((DBRec*)0)->d))	//distance bytes of DB record, every byte is one step of G table
+#define VERIFY_BATCH		1024	//points of one thread that are calculated together, one inversion per step
+#define VERIFY_MAX_REPORT	10		//bad records printed
+
+struct TVerifyCtx
+{
+	TDbFileHeader hdr;
+	EcPoint* table; //see TamesMakeGTable
+	u32 sample; //record is checked if its u16 of x is less than this value, 0x10000 - all records
+	int part_first; //first partition of current block
+	int part_cnt;
+	volatile long next_part;
+	std::vector <u8> recs;
+	std::vector <u32> list_pos;
+	std::vector <u64> checked; //per thread
+	std::vector <u64> x_err;
+	std::vector <u64> dp_err;
+	std::vector <u64> fmt_err;
+	volatile long reported;
+};
+
+struct TVerifyItem
+{
+	u32 list; //index of the list, it's first 3 bytes of x
+	u8* rec;
+};
+
+//table for batched multiplication: [TAMES_D_LEN][255] points v * 256^i * G, every point is a sum of at most TAMES_D_LEN table points
+static EcPoint* TamesMakeGTable()
+{
+	EcPoint* table = (EcPoint*)malloc(TAMES_D_LEN * 255 * sizeof(EcPoint));
+	EcInt one;
+	one.Set(1);
+	EcPoint base = Ec::MultiplyG(one);
+	for (int i = 0; i < TAMES_D_LEN; i++)
+	{
+		EcPoint* t = table + i * 255;
+		t[0] = base;
+		t[1] = Ec::DoublePoint(base);
+		for (int v = 2; v < 255; v++)
+			t[v] = Ec::AddPoints(t[v - 1], base);
+		base = Ec::AddPoints(t[254], base);
+	}
+	return table;
+}
+
+//distance of the record as absolute value, tame point is d * G, negative distance gives the same x
+static void VerifyGetDist(u8* rec, u8* d)
+{
+	EcInt val;
+	memcpy(val.data, rec + DB_FIND_LEN, TAMES_D_LEN);
+	memset(((u8*)val.data) + TAMES_D_LEN, (rec[DB_FIND_LEN + TAMES_D_LEN - 1] == 0xFF) ? 0xFF : 0, sizeof(val.data) - TAMES_D_LEN);
+	if (val.data[4] >> 63)
+		val.Neg();
+	memcpy(d, val.data, TAMES_D_LEN);
+}
+
+//calculates d * G for cnt distances (TAMES_D_LEN bytes each, up to VERIFY_BATCH) by table,
+//points are added byte by byte with batched inversion (Montgomery trick). valid is false for zero distance
+static void TamesMulG(EcPoint* table, u8 (*d)[TAMES_D_LEN], int cnt, EcPoint* pnts, bool* valid)
+{
+	int inds[VERIFY_BATCH];
+	EcInt dx[VERIFY_BATCH], prod[VERIFY_BATCH];
+	for (int k = 0; k < cnt; k++)
+		valid[k] = false;
+	for (int i = 0; i < TAMES_D_LEN; i++)
+	{
+		EcPoint* t = table + i * 255;
+		int add_cnt = 0;
+		for (int k = 0; k < cnt; k++)
+		{
+			u8 v = d[k][i];
+			if (!v)
+				continue;
+			if (!valid[k])
+			{
+				pnts[k] = t[v - 1];
+				valid[k] = true;
+				continue;
+			}
+			//x of the sum of lower bytes cannot be equal to x of the table point, it's less than 256^i in absolute value
+			dx[add_cnt] = t[v - 1].x;
+			dx[add_cnt].SubModP(pnts[k].x);
+			prod[add_cnt] = dx[add_cnt];
+			if (add_cnt)
+				prod[add_cnt].MulModP(prod[add_cnt - 1]);
+			inds[add_cnt++] = k;
+		}
+		if (!add_cnt)
+			continue;
+		EcInt inv = prod[add_cnt - 1];
+		inv.InvModP();
+		for (int a = add_cnt - 1; a >= 0; a--)
+		{
+			EcInt cur_inv = inv;
+			if (a)
+			{
+				cur_inv.MulModP(prod[a - 1]);
+				inv.MulModP(dx[a]);
+			}
+			int k = inds[a];
+			EcPoint* p1 = &pnts[k];
+			EcPoint* p2 = &t[d[k][i] - 1];
+			EcInt lambda, lambda2;
+			lambda = p2->y;
+			lambda.SubModP(p1->y);
+			lambda.MulModP(cur_inv);
+			lambda2 = lambda;
+			lambda2.MulModP(lambda);
+			EcPoint res;
+			res.x = lambda2;
+			res.x.SubModP(p1->x);
+			res.x.SubModP(p2->x);
+			res.y = p2->x;
+			res.y.SubModP(res.x);
+			res.y.MulModP(lambda);
+			res.y.SubModP(p2->y);
+			*p1 = res;
+		}
+	}
+}
+
+static void VerifyCalcPoints(TVerifyCtx* ctx, TVerifyItem* items, int cnt, EcPoint* pnts, bool* valid)
+{
+	u8 d[VERIFY_BATCH][TAMES_D_LEN];
+	for (int k = 0; k < cnt; k++)
+		VerifyGetDist(items[k].rec, d[k]);
+	TamesMulG(ctx->table, d, cnt, pnts, valid);
+}
+
+static void VerifyReport(TVerifyCtx* ctx, u32 list, u8* rec, const char* err)
+{
+#ifdef _WIN32
+	long ind = InterlockedIncrement(&ctx->reported);
+#else
+	long ind = __sync_add_and_fetch(&ctx->reported, 1);
+#endif
+	if (ind > VERIFY_MAX_REPORT)
+		return;
+	char s[2 * DB_REC_LEN + 1];
+	for (int i = 0; i < DB_REC_LEN; i++)
+		sprintf(s + 2 * i, "%02X", rec[i]);
+	printf("list %06X: %s, record %s\r\n", list, err, s);
+}
+
+static void VerifyCheckBatch(TVerifyCtx* ctx, TVerifyItem* items, int cnt, int thr_ind)
+{
+	EcPoint pnts[VERIFY_BATCH];
+	bool valid[VERIFY_BATCH];
+	VerifyCalcPoints(ctx, items, cnt, pnts, valid);
+	u64 dp_mask64 = ctx->hdr.dp ? ~((1ull << (64 - ctx->hdr.dp)) - 1) : 0;
+	u32 ext_mask = (u32)((1ull << ctx->hdr.dp_ext_bits) - 1);
+	for (int k = 0; k < cnt; k++)
+	{
+		u8* x = (u8*)pnts[k].x.data;
+		u32 list = items[k].list;
+		if (!valid[k] || (x[0] != (u8)(list >> 16)) || (x[1] != (u8)(list >> 8)) || (x[2] != (u8)list) || memcmp(x + DB_KEY_LEN, items[k].rec, DB_FIND_LEN))
+		{
+			ctx->x_err[thr_ind]++;
+			VerifyReport(ctx, list, items[k].rec, "x doesn't match distance");
+			continue;
+		}
+		if ((pnts[k].x.data[3] & dp_mask64) || (*(u32*)(x + 8) & ext_mask))
+		{
+			ctx->dp_err[thr_ind]++;
+			VerifyReport(ctx, list, items[k].rec, "point is not DP");
+		}
+	}
+	ctx->checked[thr_ind] += cnt;
+}
+
+static void verify_proc(void* data, int thr_ind)
+{
+	TVerifyCtx* ctx = (TVerifyCtx*)data;
+	TVerifyItem* items = (TVerifyItem*)malloc(VERIFY_BATCH * sizeof(TVerifyItem));
+	int cnt = 0;
+	while (1)
+	{
+		int part = TamesNextPart(&ctx->next_part);
+		if (part >= ctx->part_cnt)
+			break;
+		for (int l = part * 256; l < (part + 1) * 256; l++)
+		{
+			u32 list = (u32)(ctx->part_first + part) * 256 + (l - part * 256);
+			u8* prev = NULL;
+			for (u32 r = ctx->list_pos[l]; r < ctx->list_pos[l + 1]; r++)
+			{
+				u8* rec = ctx->recs.data() + (u64)r * DB_REC_LEN;
+				//lists must be sorted without duplicates, or DB search misses records
+				if (prev && (memcmp(prev, rec, DB_FIND_LEN) >= 0))
+				{
+					ctx->fmt_err[thr_ind]++;
+					VerifyReport(ctx, list, rec, "list is not sorted");
+				}
+				else
+					if ((rec[DB_REC_LEN - 1] & KANG_TYPE_MASK) != TAME)
+					{
+						ctx->fmt_err[thr_ind]++;
+						VerifyReport(ctx, list, rec, "not a tame");
+					}
+				prev = rec;
+				if (*(u16*)(rec + 1) >= ctx->sample)
+					continue;
+				items[cnt].list = list;
+				items[cnt].rec = rec;
+				cnt++;
+				if (cnt == VERIFY_BATCH)
+				{
+					VerifyCheckBatch(ctx, items, cnt, thr_ind);
+					cnt = 0;
+				}
+			}
+		}
+	}
+	if (cnt)
+		VerifyCheckBatch(ctx, items, cnt, thr_ind);
+	free(items);
+}
+
+/**
+ * @brief Checks records of tames file: every tame point is calculated from its distance and compared with stored x.
+ *
+ * Points are calculated on all CPU cores, in batches by precomputed table with one inversion per table step.
+ * DP of points, type and order of records are checked too. Records are read in key order by blocks like TamesMerge.
+ *
+ * @param fn Tames file.
+ * @param sample_pct Percent of records to check, 100 - all records. Records are sampled by x, I/O is the same.
+ * @return true If the file is read and no errors are found.
+ */
+bool TamesVerify(char* fn, double sample_pct)
+{
+	TVerifyCtx ctx;
+	if (!TamesCheckFile(fn, &ctx.hdr))
+		return false;
+	FILE* fp = fopen(fn, "rb");
+	if (!fp)
+	{
+		printf("error: cannot open %s\r\n", fn);
+		return false;
+	}
+	setvbuf(fp, NULL, _IOFBF, 4 * 1024 * 1024);
+	fseek(fp, sizeof(TDbFileHeader), SEEK_SET);
+	ctx.sample = (sample_pct >= 100.0) ? 0x10000 : (u32)(sample_pct * 0x10000 / 100.0);
+	if (!ctx.sample)
+		ctx.sample = 1;
+	int thr_cnt = TamesCpuCnt();
+	ctx.checked.assign(thr_cnt, 0);
+	ctx.x_err.assign(thr_cnt, 0);
+	ctx.dp_err.assign(thr_cnt, 0);
+	ctx.fmt_err.assign(thr_cnt, 0);
+	ctx.reported = 0;
+	printf("verifying %s: %llu records, range %d, DP %d, %.3f%% of records, %d threads...\r\n", fn, ctx.hdr.rec_cnt, ctx.hdr.range, ctx.hdr.dp + ctx.hdr.dp_ext_bits, 100.0 * ctx.sample / 0x10000, thr_cnt);
+	ctx.table = TamesMakeGTable();
+
+	double part_bytes = (double)GetFileLen(fn) / TAMES_PART_CNT;
+	int block_parts = (int)(TAMES_MEM_LIMIT / (part_bytes + 1));
+	if (block_parts < 1)
+		block_parts = 1;
+	if (block_parts > TAMES_PART_CNT)
+		block_parts = TAMES_PART_CNT;
+	bool res = true;
+	u64 read_recs = 0;
+	u64 tm_start = GetTickCount64();
+	u64 tm_stats = tm_start;
+	for (int part = 0; part < TAMES_PART_CNT; part += block_parts)
+	{
+		ctx.part_first = part;
+		ctx.part_cnt = (block_parts < TAMES_PART_CNT - part) ? block_parts : TAMES_PART_CNT - part;
+		if (!TamesReadParts(fp, ctx.part_cnt, ctx.recs, ctx.list_pos))
+		{
+			printf("%s: read error\r\n", fn);
+			res = false;
+			break;
+		}
+		read_recs += ctx.list_pos[ctx.part_cnt * 256];
+		ctx.next_part = 0;
+		TamesRunThreads(verify_proc, &ctx, thr_cnt);
+		if (GetTickCount64() - tm_stats > 10 * 1000)
+		{
+			u64 checked = 0;
+			for (int i = 0; i < thr_cnt; i++)
+				checked += ctx.checked[i];
+			double sec = (GetTickCount64() - tm_start) / 1000.0;
+			printf("verified %.1f%%, %.3f M points/s\r\n", 100.0 * (part + ctx.part_cnt) / TAMES_PART_CNT, checked / sec / 1000000);
+			tm_stats = GetTickCount64();
+		}
+	}
+	fclose(fp);
+	free(ctx.table);
+
+	u64 checked = 0, x_err = 0, dp_err = 0, fmt_err = 0;
+	for (int i = 0; i < thr_cnt; i++)
+	{
+		checked += ctx.checked[i];
+		x_err += ctx.x_err[i];
+		dp_err += ctx.dp_err[i];
+		fmt_err += ctx.fmt_err[i];
+	}
+	double sec = (GetTickCount64() - tm_start) / 1000.0 + 0.001;
+	printf("records read: %llu, points checked: %llu, time %.1f s, %.3f M points/s, %.1f MB/s\r\n", read_recs, checked, sec, checked / sec / 1000000, read_recs * DB_REC_LEN / sec / (1024 * 1024));
+	printf("errors: x %llu, DP %llu, type/order %llu\r\n", x_err, dp_err, fmt_err);
+	if (res && (read_recs != ctx.hdr.rec_cnt))
+	{
+		printf("error: header has %llu records\r\n", ctx.hdr.rec_cnt);
+		res = false;
+	}
+	if (res && !x_err && !dp_err && !fmt_err)
+		printf("tames file is OK\r\n");
+	return res && !x_err && !dp_err && !fmt_err;
+}
+
+struct TGenCtx
+{
+	char* fn;
+	TDbFileHeader hdr; //for runs, total_ops and rec_cnt are set for every run
+	EcJMP* jumps[3];
+	EcPoint* table; //see TamesMakeGTable, for start points
+	int thr_cnt; //generation threads, thread 0 writes runs
+	double max_ops;
+	u64 prev_ops; //ops of runs of previous interrupted generation
+	volatile bool stop;
+	std::vector <u64> ops; //per thread
+	CriticalSection cs;
+	std::vector <DBRec> dps; //DPs of current run, protected by cs
+	int run_cnt; //runs on disk
+	u64 run_ops; //ops of runs written by this generation
+	bool ok;
+};
+
+static void GenRunName(char* res, char* fn, int ind)
+{
+	sprintf(res, "%s.run%d", fn, ind);
+}
+
+static bool GenRecLess(const DBRec& a, const DBRec& b)
+{
+	return memcmp(a.x, b.x, DB_KEY_LEN + DB_FIND_LEN) < 0;
+}
+
+//sorts DPs and writes them as a tames file, so every run can be merged, verified or used alone
+//run is written to a temp file, synced and renamed, so a crash never leaves a truncated run
+static bool GenWriteRun(TGenCtx* ctx, std::vector <DBRec>& dps, u64 ops)
+{
+	char name[1100], tmp_name[1100];
+	GenRunName(name, ctx->fn, ctx->run_cnt);
+	sprintf(tmp_name, "%s.tmp", name);
+	std::sort(dps.begin(), dps.end(), GenRecLess);
+	TDbFileHeader hdr = ctx->hdr;
+	hdr.total_ops = ops;
+	hdr.rec_cnt = 0;
+	FILE* fp = fopen(tmp_name, "wb");
+	if (!fp)
+	{
+		printf("error: cannot create %s\r\n", tmp_name);
+		return false;
+	}
+	setvbuf(fp, NULL, _IOFBF, 4 * 1024 * 1024);
+	bool res = fwrite(&hdr, 1, sizeof(hdr), fp) == sizeof(hdr);
+	u64 pos = 0;
+	for (u32 l = 0; res && (l < 256 * 256 * 256); l++)
+	{
+		u16 cnt = 0;
+		u64 end = pos;
+		while ((end < dps.size()) && ((((u32)dps[end].x[0] << 16) | ((u32)dps[end].x[1] << 8) | dps[end].x[2]) == l))
+			end++;
+		//tames of the same path give the same DP, only one is kept
+		for (u64 i = pos; i < end; i++)
+			if (((i == pos) || memcmp(dps[i].x, dps[i - 1].x, DB_KEY_LEN + DB_FIND_LEN)) && (cnt < 0xFFFF))
+				dps[pos + cnt++] = dps[i];
+		res = fwrite(&cnt, 1, 2, fp) == 2;
+		for (int i = 0; res && (i < cnt); i++)
+			res = fwrite((u8*)&dps[pos + i] + DB_KEY_LEN, 1, DB_REC_LEN, fp) == DB_REC_LEN;
+		hdr.rec_cnt += cnt;
+		pos = end;
+	}
+	if (res)
+	{
+		fseek(fp, 0, SEEK_SET);
+		res = (fwrite(&hdr, 1, sizeof(hdr), fp) == sizeof(hdr)) && !fflush(fp);
+#ifdef _WIN32
+		res = res && !_commit(_fileno(fp));
+#else
+		res = res && !fsync(fileno(fp));
+#endif
+	}
+	if (fclose(fp))
+		res = false;
+	if (res)
+	{
+#ifdef _WIN32
+		remove(name);
+#endif
+		res = !rename(tmp_name, name);
+	}
+	if (!res)
+	{
+		printf("error: cannot write %s\r\n", name);
+		remove(tmp_name);
+		return false;
+	}
+	ctx->run_cnt++;
+	printf("run %s saved: %llu DPs\r\n", name, hdr.rec_cnt);
+	return true;
+}
+
+static void GenFlushDPs(TGenCtx* ctx, std::vector <DBRec>& dps)
+{
+	if (dps.empty())
+		return;
+	ctx->cs.Enter();
+	ctx->dps.insert(ctx->dps.end(), dps.begin(), dps.end());
+	ctx->cs.Leave();
+	dps.clear();
+}
+
+//start points of GPU tames generation: KernelGen doesn't add PntA/PntB in gen mode, so every kang starts at d*G,
+//1/3 of kangs (tame slots) have d of range-4 bits, the rest (wild slots) have even d of range-1 bits.
+//all of them are tames, GPU gen mode stores every DP as TAME too
+static void GenStartKangs(TGenCtx* ctx, EcPoint* pnts, EcInt* dists)
+{
+	int range = ctx->hdr.range;
+	u8 d[TAMES_GEN_KANG_CNT][TAMES_D_LEN];
+	bool valid[TAMES_GEN_KANG_CNT];
+	for (int k = 0; k < TAMES_GEN_KANG_CNT; k++)
+	{
+		do
+		{
+			if (k % 3 == 0)
+				dists[k].RndBits(range - 4);
+			else
+			{
+				dists[k].RndBits(range - 1);
+				dists[k].data[0] &= 0xFFFFFFFFFFFFFFFE;
+			}
+		} while (dists[k].IsZero());
+		memcpy(d[k], dists[k].data, TAMES_D_LEN);
+	}
+	TamesMulG(ctx->table, d, TAMES_GEN_KANG_CNT, pnts, valid);
+}
+
+//kangs jump exactly like on GPU (see KernelA): jump index is x % JMP_CNT, jump is subtracted if y is odd,
+//L1S2 loops switch to jumps2 for one jump, longer loops are found by distance history and escaped with jumps3
+static void gen_proc(void* data, int thr_ind)
+{
+	TGenCtx* ctx = (TGenCtx*)data;
+	if (!thr_ind)
+		return;
+	EcPoint* pnts = new EcPoint[TAMES_GEN_KANG_CNT];
+	EcInt* dists = new EcInt[TAMES_GEN_KANG_CNT];
+	EcInt* dx = new EcInt[TAMES_GEN_KANG_CNT];
+	EcInt* prod = new EcInt[TAMES_GEN_KANG_CNT];
+	u16* jmp_inds = (u16*)malloc(TAMES_GEN_KANG_CNT * sizeof(u16));
+	bool* l1s2 = (bool*)calloc(TAMES_GEN_KANG_CNT, sizeof(bool));
+	u64* hist = (u64*)calloc(TAMES_GEN_KANG_CNT * MD_LEN, sizeof(u64));
+	std::vector <DBRec> dps; //DPs of this thread, they go to ctx->dps in batches
+	GenStartKangs(ctx, pnts, dists);
+	u64 dp_mask64 = ~((1ull << (64 - ctx->hdr.dp)) - 1);
+	u32 ext_mask = (u32)((1ull << ctx->hdr.dp_ext_bits) - 1);
+	u32 step = 0;
+	while (!ctx->stop)
+	{
+		for (int k = 0; k < TAMES_GEN_KANG_CNT; k++)
+		{
+			jmp_inds[k] = pnts[k].x.data[0] % JMP_CNT;
+			EcJMP* jmp = (l1s2[k] ? ctx->jumps[1] : ctx->jumps[0]) + jmp_inds[k];
+			dx[k] = pnts[k].x;
+			dx[k].SubModP(jmp->p.x);
+			prod[k] = dx[k];
+			if (k)
+				prod[k].MulModP(prod[k - 1]);
+		}
+		EcInt inv = prod[TAMES_GEN_KANG_CNT - 1];
+		inv.InvModP();
+		int it = step % MD_LEN;
+		for (int k = TAMES_GEN_KANG_CNT - 1; k >= 0; k--)
+		{
+			EcInt cur_inv = inv;
+			if (k)
+			{
+				cur_inv.MulModP(prod[k - 1]);
+				inv.MulModP(dx[k]);
+			}
+			EcJMP* jmp = (l1s2[k] ? ctx->jumps[1] : ctx->jumps[0]) + jmp_inds[k];
+			EcPoint* p = &pnts[k];
+			EcInt jy = jmp->p.y;
+			bool inv_flag = p->y.data[0] & 1;
+			if (inv_flag)
+				jy.NegModP();
+			EcInt lambda, lambda2;
+			lambda = p->y;
+			lambda.SubModP(jy);
+			lambda.MulModP(cur_inv);
+			lambda2 = lambda;
+			lambda2.MulModP(lambda);
+			EcPoint res;
+			res.x = lambda2;
+			res.x.SubModP(jmp->p.x);
+			res.x.SubModP(p->x);
+			res.y = p->x;
+			res.y.SubModP(res.x);
+			res.y.MulModP(lambda);
+			res.y.SubModP(p->y);
+			*p = res;
+			EcInt jd = jmp->dist;
+			if (inv_flag)
+				dists[k].Sub(jd);
+			else
+				dists[k].Add(jd);
+
+			if (!l1s2[k])
+			{
+				u32 cur = jmp_inds[k] | (inv_flag ? INV_FLAG : 0);
+				u32 next = (p->x.data[0] % JMP_CNT) | ((p->y.data[0] & 1) ? 0 : INV_FLAG);
+				l1s2[k] = (cur == next);
+			}
+			else
+				l1s2[k] = false;
+
+			//same checks as KernelB: distance was seen 4, 6, 8 or 10 jumps ago
+			u64* h = hist + k * MD_LEN;
+			u64 d0 = dists[k].data[0];
+			bool looped = (h[(it + MD_LEN - 4) % MD_LEN] == d0) || (h[(it + MD_LEN - 6) % MD_LEN] == d0) || (h[(it + MD_LEN - 8) % MD_LEN] == d0) || (h[it] == d0);
+			h[it] = d0;
+			if (looped)
+			{
+				EcJMP* jmp3 = ctx->jumps[2] + (p->x.data[0] % JMP_CNT);
+				EcPoint jp = jmp3->p;
+				jd = jmp3->dist;
+				if (p->y.data[0] & 1)
+				{
+					jp.y.NegModP();
+					dists[k].Sub(jd);
+				}
+				else
+					dists[k].Add(jd);
+				*p = Ec::AddPoints(*p, jp);
+				l1s2[k] = false;
+				continue;
+			}
+			//same test as KernelB: extra DP bits are the low bits of x[1]
+			if ((p->x.data[3] & dp_mask64) || ((u32)p->x.data[1] & ext_mask))
+				continue;
+			DBRec rec;
+			memcpy(rec.x, p->x.data, sizeof(rec.x));
+			memcpy(rec.d, dists[k].data, sizeof(rec.d));
+			rec.type = TAME;
+			dps.push_back(rec);
+		}
+		ctx->ops[thr_ind] += TAMES_GEN_KANG_CNT;
+		step++;
+		if (dps.size() >= TAMES_GEN_DP_BATCH)
+			GenFlushDPs(ctx, dps);
+	}
+	GenFlushDPs(ctx, dps);
+	free(hist);
+	free(l1s2);
+	free(jmp_inds);
+	delete[] prod;
+	delete[] dx;
+	delete[] dists;
+	delete[] pnts;
+}
+
+static u64 GenGetOps(TGenCtx* ctx)
+{
+	u64 ops = 0;
+	for (int i = 0; i < ctx->thr_cnt; i++)
+		ops += ctx->ops[i];
+	return ops;
+}
+
+//thread 0: shows stats, writes runs and stops generation when max_ops is reached
+static void gen_ctrl_proc(void* data, int thr_ind)
+{
+	TGenCtx* ctx = (TGenCtx*)data;
+	if (thr_ind)
+	{
+		gen_proc(data, thr_ind);
+		return;
+	}
+	u64 tm_start = GetTickCount64();
+	u64 tm_stats = tm_start;
+	u64 tm_run = tm_start;
+	u64 stats_ops = 0;
+	while (1)
+	{
+		Sleep(100);
+		u64 ops = GenGetOps(ctx);
+		bool done = ctx->prev_ops + ops >= ctx->max_ops;
+		ctx->cs.Enter();
+		u64 dp_cnt = ctx->dps.size();
+		ctx->cs.Leave();
+		if (GetTickCount64() - tm_stats >= 10 * 1000)
+		{
+			double sec = (GetTickCount64() - tm_stats) / 1000.0;
+			printf("GEN: CPU speed: %.3f MKeys/s, DPs: %lluK in memory, runs: %d, ops: 2^%.3f of 2^%.3f\r\n", (ops - stats_ops) / sec / 1000000, dp_cnt / 1000, ctx->run_cnt,
+				log2((double)(ctx->prev_ops + ops) + 1), log2(ctx->max_ops));
+			stats_ops = ops;
+			tm_stats = GetTickCount64();
+		}
+		//runs are written when memory limit or interval is reached, DPs in memory are lost on crash
+		if (!done && (dp_cnt * sizeof(DBRec) < TAMES_MEM_LIMIT / 2) && (GetTickCount64() - tm_run < TAMES_RUN_INTERVAL * 1000ull))
+			continue;
+		if (done)
+		{
+			ctx->stop = true;
+			return; //last run is written after all threads are stopped
+		}
+		std::vector <DBRec> run;
+		ctx->cs.Enter();
+		run.swap(ctx->dps);
+		ops = GenGetOps(ctx);
+		ctx->cs.Leave();
+		//ops are counted after every step, DPs of current step can be in the next run, it doesn't matter for total
+		if (!GenWriteRun(ctx, run, ops - ctx->run_ops))
+		{
+			ctx->ok = false;
+			ctx->stop = true;
+			return;
+		}
+		ctx->run_ops = ops;
+		tm_run = GetTickCount64();
+	}
+}
+
+/**
+ * @brief Generates tames on all CPU cores and saves them to a tames file.
+ *
+ * DPs are written to disk periodically as sorted runs ("<fn>.run<N>", tames files), so memory is limited and a crash loses
+ * only DPs after the last run. Runs left by interrupted generation are kept and counted in max_ops, unfinished run is removed.
+ * At the end all runs (and the existing file if extend is set) are merged by TamesMerge into fn and removed.
+ *
+ * @param fn Tames file.
+ * @param hdr Header for runs: range, DP and jumps of the session.
+ * @param jumps1 Main jumps of the session, JMP_CNT.
+ * @param jumps2 Jumps for L1S2 loops.
+ * @param jumps3 Jumps to escape longer loops.
+ * @param max_ops Ops limit for all runs.
+ * @param extend Existing file fn is merged with new tames.
+ * @return true If the tames file is saved.
+ */
+bool TamesGenerate(char* fn, TDbFileHeader* hdr, EcJMP* jumps1, EcJMP* jumps2, EcJMP* jumps3, double max_ops, bool extend)
+{
+	TGenCtx ctx;
+	ctx.fn = fn;
+	ctx.hdr = *hdr;
+	ctx.jumps[0] = jumps1;
+	ctx.jumps[1] = jumps2;
+	ctx.jumps[2] = jumps3;
+	ctx.max_ops = max_ops;
+	ctx.prev_ops = 0;
+	ctx.run_cnt = 0;
+	ctx.run_ops = 0;
+	ctx.ok = true;
+	ctx.stop = false;
+	//runs of interrupted generation
+	char name[1100];
+	while (1)
+	{
+		GenRunName(name, fn, ctx.run_cnt);
+		if (!IsFileExist(name))
+			break;
+		TDbFileHeader run_hdr;
+		if (!TamesCheckFile(name, &run_hdr))
+			return false;
+		if ((run_hdr.range != hdr->range) || (run_hdr.dp != hdr->dp) || (run_hdr.dp_ext_bits != hdr->dp_ext_bits) || (run_hdr.jump_hash != hdr->jump_hash))
+		{
+			printf("error: %s was made with different range, DP or jumps, remove it\r\n", name);
+			return false;
+		}
+		ctx.prev_ops += run_hdr.total_ops;
+		ctx.run_cnt++;
+	}
+	//run that was being written when generation was interrupted
+	strcat(name, ".tmp");
+	remove(name);
+	if (ctx.run_cnt)
+		printf("%d runs of previous generation found, ops: 2^%.3f\r\n", ctx.run_cnt, log2((double)ctx.prev_ops + 1));
+
+	ctx.thr_cnt = TamesCpuCnt() + 1;
+	ctx.ops.assign(ctx.thr_cnt, 0);
+	ctx.hdr.gpu_cnt = 0;
+	ctx.hdr.kang_cnt = (ctx.thr_cnt - 1) * TAMES_GEN_KANG_CNT;
+	printf("CPU tames generation: range %d, DP %d, %d threads, %d kangs\r\n", hdr->range, hdr->dp + hdr->dp_ext_bits, ctx.thr_cnt - 1, ctx.hdr.kang_cnt);
+	ctx.table = TamesMakeGTable();
+	if (ctx.prev_ops < max_ops)
+	{
+		TamesRunThreads(gen_ctrl_proc, &ctx, ctx.thr_cnt);
+		//DPs after the last run
+		if (ctx.ok)
+			ctx.ok = GenWriteRun(&ctx, ctx.dps, GenGetOps(&ctx) - ctx.run_ops);
+	}
+	free(ctx.table);
+	if (!ctx.ok)
+		return false;
+
+	std::vector <std::string> names;
+	std::vector <char*> in_files;
+	if (extend)
+		in_files.push_back(fn);
+	for (int i = 0; i < ctx.run_cnt; i++)
+	{
+		GenRunName(name, fn, i);
+		names.push_back(name);
+	}
+	for (int i = 0; i < ctx.run_cnt; i++)
+		in_files.push_back((char*)names[i].c_str());
+	sprintf(name, "%s.tmp", fn); //merge output, fn is replaced when it's ready
+	if (!TamesMerge(in_files, name))
+		return false;
+	remove(fn);
+	if (rename(name, fn))
+	{
+		printf("error: cannot rename %s to %s\r\n", name, fn);
+		return false;
+	}
+	for (int i = 0; i < ctx.run_cnt; i++)
+		remove(names[i].c_str());
+	printf("tames saved to %s\r\n", fn);
+	return true;
+}
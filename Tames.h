@@ -0,0 +1,28 @@
+// Tames.h
+//
+// This file is a part of RCKangaroo software
+// (c) 2024, RetiredCoder (RC)
+// License: GPLv3, see "LICENSE.TXT" file
+// https://github.com/RetiredC
+
+
+#pragma once
+
+#include "defs.h"
+#include "utils.h"
+#include "GpuKang.h"
+
+//tools for tames files, they work with files directly (streaming) and don't load them to DB.
+//file is processed by partitions of the first two key bytes (256 lists each), so memory doesn't depend on file size
+#define TAMES_PART_CNT		(256 * 256)
+#define TAMES_MEM_LIMIT		(1024ull * 1024 * 1024)	//buffers of one block of partitions of all files
+//CPU tames generation
+#define TAMES_GEN_KANG_CNT	512			//kangs of one thread, they jump together with one inversion per step
+#define TAMES_GEN_DP_BATCH	256			//DPs are buffered by every thread and added to the current run in batches
+#define TAMES_RUN_INTERVAL	(10 * 60)	//max seconds between sorted runs written to disk
+
+bool TamesCheckFile(char* fn, TDbFileHeader* hdr);
+bool TamesMerge(std::vector <char*>& in_files, char* out_file);
+bool TamesDownsample(char* in_file, char* out_file, int dp);
+bool TamesVerify(char* fn, double sample_pct);
+bool TamesGenerate(char* fn, TDbFileHeader* hdr, EcJMP* jumps1, EcJMP* jumps2, EcJMP* jumps3, double max_ops, bool extend);
@@ -22,6 +22,7 @@ typedef char i8;
 
 
 #define MAX_GPU_CNT			32
+#define MAX_NODE_CNT		65536
 
 //must be divisible by MD_LEN
 #define STEP_CNT			1000
@@ -52,6 +53,11 @@ typedef char i8;
 #define WILD1				1  // Wild kangs1 
 #define WILD2				2  // Wild kangs2
 
+// DP type byte: low bits are kang type, high bits are target index in multi-target mode
+#define KANG_TYPE_MASK		3
+#define TARGET_SHIFT		2
+#define MAX_TARGET_CNT		64
+
 #define GPU_DP_SIZE			48
 #define MAX_DP_CNT			(256 * 1024)
 
@@ -67,6 +73,26 @@ typedef char i8;
 
 #define MD_LEN				10
 
+//"-dp auto": records used to measure DB memory per record
+#define DP_AUTO_SAMPLE_CNT	(2 * 1024 * 1024)
+//"-dp auto": DB must fit ops*DP_AUTO_OPS_MARGIN if -max is not set, K has a long tail
+#define DP_AUTO_OPS_MARGIN	2.0
+//"-dp auto": DP overhead (kangs*2^DP/ops) must not exceed this value, same as "DPs per kangaroo >= 5"
+#define DP_AUTO_MAX_OVERHEAD	0.2
+//"-dp auto": DPs of one GPU iteration (kangs*STEP_CNT/2^DP) must fit this part of MAX_DP_CNT buffer
+#define DP_AUTO_MAX_DP_FILL		0.5
+//DP is raised by one bit when DB memory reaches this part of -ram limit
+#define DP_RAISE_LEVEL		0.9
+
+#define CHECKPOINT_VERSION	2
+#define CHECKPOINT_FLAG_DB	1	//checkpoint contains DB, otherwise DB is tames + DP journal
+#define JOURNAL_VERSION		1
+
+//tames and wilds files, see TDbFileHeader
+#define DB_FILE_VERSION		1
+#define DB_FILE_TAMES		1
+#define DB_FILE_WILDS		2
+
 //#define DEBUG_MODE
 
 //gpu kernel parameters
@@ -79,6 +105,7 @@ struct TKparams
 	u32 GroupCnt;
 	u64* L2;
 	u64 DP;
+	u64 DPExtMask; //raised DP, these bits of x[1] must be zero too
 	u32* DPs_out;
 	u64* Jumps1; //x(32b), y(32b), d(32b)
 	u64* Jumps2; //x(32b), y(32b), d(32b)
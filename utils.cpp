@@ -9,8 +9,13 @@
 
 #ifdef _WIN32
 
+#include <io.h>
+
 #else
 
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
 void _BitScanReverse64(u32* index, u64 msk) 
 {
     *index = 63 - __builtin_clzll(msk); 
@@ -21,6 +26,11 @@ void _BitScanForward64(u32* index, u64 msk)
     *index = __builtin_ffsll(msk) - 1; 
 }
 
+u64 __popcnt64(u64 msk)
+{
+    return __builtin_popcountll(msk);
+}
+
 u64 _umul128(u64 m1, u64 m2, u64* hi) 
 { 
     uint128_t ab = (uint128_t)m1 * m2; *hi = (u64)(ab >> 64); return (u64)ab; 
@@ -56,9 +66,8 @@ u64 GetTickCount64()
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-#define DB_REC_LEN			32
-#define DB_FIND_LEN			9
 #define DB_MIN_GROW_CNT		2
+#define DB_PREFETCH_DIST	4
 
 //we need advanced memory management to reduce memory fragmentation
 //everything will be stable up to about 8TB RAM
@@ -67,9 +76,183 @@ u64 GetTickCount64()
 #define RECS_IN_PAGE		(MEM_PAGE_SIZE / DB_REC_LEN)
 #define MAX_PAGES_CNT		(0xFFFFFFFF / RECS_IN_PAGE)
 
+#define CHUNK_SIZE			(32 * 1024 * 1024)
+#define HUGE_PAGE_2MB		(2 * 1024 * 1024)
+#define HUGE_PAGE_1GB		(1024 * 1024 * 1024ull)
+
+#ifndef _WIN32
+
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT		26
+#endif
+#define MAP_HUGE_1GB_FLAG	(30 << MAP_HUGE_SHIFT)
+
+//we don't want libnuma dependency, so call mbind directly
+#define MPOL_BIND_MODE			2
+#define MPOL_INTERLEAVE_MODE	3
+#define MPOL_MF_MOVE_FLAG		(1 << 1)
+
+static int GetNumaNodeCnt()
+{
+	int cnt = 0;
+	while (cnt < DB_MAX_NUMA_NODES)
+	{
+		char path[100];
+		sprintf(path, "/sys/devices/system/node/node%d", cnt);
+		if (access(path, F_OK))
+			break;
+		cnt++;
+	}
+	return cnt ? cnt : 1;
+}
+
+#endif
+
+PageAlloc::PageAlloc()
+{
+	huge_mode = DB_HUGE_NONE;
+	numa_mode = DB_NUMA_NONE;
+	node_cnt = 1;
+	chunk_size = CHUNK_SIZE;
+	memset(cur, 0, sizeof(cur));
+	memset(cur_left, 0, sizeof(cur_left));
+}
+
+PageAlloc::~PageAlloc()
+{
+	Clear();
+}
+
+bool PageAlloc::Init(int _huge_mode, int _numa_mode)
+{
+	Clear();
+#ifdef _WIN32
+	if ((_huge_mode != DB_HUGE_NONE) || (_numa_mode != DB_NUMA_NONE))
+	{
+		printf("huge pages and NUMA options are not supported on Windows\r\n");
+		return false;
+	}
+#else
+	huge_mode = _huge_mode;
+	numa_mode = _numa_mode;
+	node_cnt = (numa_mode != DB_NUMA_NONE) ? GetNumaNodeCnt() : 1;
+	chunk_size = (huge_mode == DB_HUGE_1GB) ? HUGE_PAGE_1GB : CHUNK_SIZE;
+#endif
+	return true;
+}
+
+//applies transparent huge pages and NUMA policy to the memory range, must be called before memory is touched
+//node_mask is used for DB_NUMA_BIND, DB_NUMA_INTERLEAVE uses all nodes
+bool PageAlloc::PlaceMemory(void* ptr, u64 size, bool thp, int numa_mode, u64 node_mask)
+{
+#ifdef _WIN32
+	return false;
+#else
+	bool res = true;
+	if (thp)
+		res = !madvise(ptr, size, MADV_HUGEPAGE);
+	if (numa_mode != DB_NUMA_NONE)
+	{
+		int node_cnt = GetNumaNodeCnt();
+		if (node_cnt < 2)
+			return res;
+		u64 mask = node_mask;
+		if (numa_mode == DB_NUMA_INTERLEAVE)
+			mask = (node_cnt >= 64) ? 0xFFFFFFFFFFFFFFFFull : ((1ull << node_cnt) - 1);
+		int mode = (numa_mode == DB_NUMA_BIND) ? MPOL_BIND_MODE : MPOL_INTERLEAVE_MODE;
+		res = !syscall(SYS_mbind, ptr, size, mode, &mask, sizeof(mask) * 8 + 1, MPOL_MF_MOVE_FLAG) && res;
+	}
+	return res;
+#endif
+}
+
+u8* PageAlloc::AllocChunk(int node)
+{
+#ifdef _WIN32
+	return NULL;
+#else
+	int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE;
+	void* mem = MAP_FAILED;
+	u64 size = chunk_size;
+	if (huge_mode == DB_HUGE_2MB)
+		mem = mmap(NULL, size, PROT_READ | PROT_WRITE, flags | MAP_HUGETLB, -1, 0);
+	if (huge_mode == DB_HUGE_1GB)
+		mem = mmap(NULL, size, PROT_READ | PROT_WRITE, flags | MAP_HUGETLB | MAP_HUGE_1GB_FLAG, -1, 0);
+	if ((mem == MAP_FAILED) && ((huge_mode == DB_HUGE_2MB) || (huge_mode == DB_HUGE_1GB)))
+	{
+		printf("cannot allocate reserved huge pages for DB, use transparent huge pages\r\n");
+		huge_mode = DB_HUGE_THP;
+		chunk_size = CHUNK_SIZE;
+		size = chunk_size;
+	}
+	u8* res;
+	if (mem == MAP_FAILED)
+	{
+		//extra 2MB to align chunk for THP
+		size += HUGE_PAGE_2MB;
+		mem = mmap(NULL, size, PROT_READ | PROT_WRITE, flags, -1, 0);
+		if (mem == MAP_FAILED)
+			return NULL;
+		res = (u8*)(((u64)mem + HUGE_PAGE_2MB - 1) & ~(u64)(HUGE_PAGE_2MB - 1));
+	}
+	else
+		res = (u8*)mem;
+	TChunk chunk;
+	chunk.ptr = mem;
+	chunk.size = size;
+	chunks.push_back(chunk);
+	PlaceMemory(res, chunk_size, huge_mode == DB_HUGE_THP, numa_mode, 1ull << node);
+	return res;
+#endif
+}
+
+void* PageAlloc::AllocPage(int node)
+{
+	node %= node_cnt;
+	if (cur_left[node] < MEM_PAGE_SIZE)
+	{
+		cur[node] = AllocChunk(node);
+		if (!cur[node])
+		{
+			cur_left[node] = 0;
+			return NULL;
+		}
+		cur_left[node] = chunk_size;
+	}
+	void* res = cur[node];
+	cur[node] += MEM_PAGE_SIZE;
+	cur_left[node] -= MEM_PAGE_SIZE;
+	return res;
+}
+
+//returns memory of unused page to OS, page stays mapped and is zeroed on next touch.
+//reserved huge pages (MAP_HUGETLB) cannot be released by MEM_PAGE_SIZE parts, they are kept for reuse
+void PageAlloc::ReleasePage(void* page)
+{
+#ifndef _WIN32
+	if ((huge_mode == DB_HUGE_2MB) || (huge_mode == DB_HUGE_1GB))
+		return;
+	madvise(page, MEM_PAGE_SIZE, MADV_DONTNEED);
+#endif
+}
+
+void PageAlloc::Clear()
+{
+#ifndef _WIN32
+	for (int i = 0; i < (int)chunks.size(); i++)
+		munmap(chunks[i].ptr, chunks[i].size);
+#endif
+	chunks.clear();
+	memset(cur, 0, sizeof(cur));
+	memset(cur_left, 0, sizeof(cur_left));
+}
+
 MemPool::MemPool()
 {
+	used = 0;
 	pnt = 0;
+	palloc = NULL;
+	node = 0;
 }
 
 MemPool::~MemPool()
@@ -79,30 +262,66 @@ MemPool::~MemPool()
 
 void MemPool::Clear()
 {
-	int cnt = (int)pages.size();
-	for (int i = 0; i < cnt; i++)
-		free(pages[i]);
+	//pages from PageAlloc are released by PageAlloc
+	if (!palloc || !palloc->IsEnabled())
+	{
+		int cnt = (int)pages.size();
+		for (int i = 0; i < cnt; i++)
+			free(pages[i]);
+	}
 	pages.clear();
+	used = 0;
+	pnt = 0;
+}
+
+//keeps pages, they will be reused by next allocations
+void MemPool::Reset()
+{
+	used = 0;
 	pnt = 0;
 }
 
 void* MemPool::AllocRec(u32* cmp_ptr)
 {
 	void* mem;
-	if (pages.empty() || (pnt + DB_REC_LEN > MEM_PAGE_SIZE))
+	if (!used || (pnt + DB_REC_LEN > MEM_PAGE_SIZE))
 	{
-		if (pages.size() >= MAX_PAGES_CNT)
+		if (used >= MAX_PAGES_CNT)
 			return NULL; //overflow
-		pages.push_back(malloc(MEM_PAGE_SIZE));
+		if (used == pages.size())
+		{
+			void* page = (palloc && palloc->IsEnabled()) ? palloc->AllocPage(node) : malloc(MEM_PAGE_SIZE);
+			if (!page)
+				return NULL;
+			pages.push_back(page);
+		}
+		used++;
 		pnt = 0;
 	}
-	u32 page_ind = (u32)pages.size() - 1;
+	u32 page_ind = used - 1;
 	mem = (u8*)pages[page_ind] + pnt;
 	*cmp_ptr = (page_ind * RECS_IN_PAGE) | (pnt / DB_REC_LEN);
 	pnt += DB_REC_LEN;
 	return mem;
 }
 
+//pool keeps first rec_cnt records (they must be moved there already), pages after them are freed
+void MemPool::Trim(u32 rec_cnt)
+{
+	used = (rec_cnt + RECS_IN_PAGE - 1) / RECS_IN_PAGE;
+	pnt = (rec_cnt - (used ? used - 1 : 0) * RECS_IN_PAGE) * DB_REC_LEN;
+	//pages from PageAlloc stay in the pool for reuse, but their memory goes back to OS
+	if (palloc && palloc->IsEnabled())
+	{
+		for (u32 i = used; i < (u32)pages.size(); i++)
+			palloc->ReleasePage(pages[i]);
+		return;
+	}
+	for (u32 i = used; i < (u32)pages.size(); i++)
+		free(pages[i]);
+	pages.resize(used);
+}
+
 void* MemPool::GetRecPtr(u32 cmp_ptr)
 {
 	u32 page_ind = cmp_ptr / RECS_IN_PAGE;
@@ -110,10 +329,94 @@ void* MemPool::GetRecPtr(u32 cmp_ptr)
 	return (u8*)pages[page_ind] + DB_REC_LEN * rec_ind;
 }
 
+ListArena::ListArena()
+{
+	//same capacity steps as realloc growth had: +50%, at least DB_MIN_GROW_CNT, up to 0xFFFF
+	memset(cap_class, 0, sizeof(cap_class));
+	class_cap[0] = 0;
+	int cnt = 1;
+	while (class_cap[cnt - 1] < 0xFFFF)
+	{
+		u32 cap = class_cap[cnt - 1];
+		u32 grow = cap / 2;
+		if (grow < DB_MIN_GROW_CNT)
+			grow = DB_MIN_GROW_CNT;
+		cap += grow;
+		if (cap > 0xFFFF)
+			cap = 0xFFFF;
+		class_cap[cnt] = cap;
+		cap_class[cap] = cnt;
+		cnt++;
+	}
+	class_cap[cnt] = 0xFFFF; //no next class for the largest one
+	used = 0;
+	pnt = DB_LIST_CHUNK_SIZE;
+	memset(free_arrays, 0, sizeof(free_arrays));
+}
+
+ListArena::~ListArena()
+{
+	Clear();
+}
+
+void ListArena::Clear()
+{
+	for (int i = 0; i < (int)chunks.size(); i++)
+		free(chunks[i]);
+	chunks.clear();
+	Reset();
+}
+
+void ListArena::Reset()
+{
+	used = 0;
+	pnt = DB_LIST_CHUNK_SIZE;
+	memset(free_arrays, 0, sizeof(free_arrays));
+}
+
+//cap must be one of class capacities
+u32* ListArena::Alloc(u16 cap)
+{
+	int cls = cap_class[cap];
+	u32* arr = free_arrays[cls];
+	if (arr)
+	{
+		memcpy(&free_arrays[cls], arr, sizeof(u32*)); //free arrays keep pointer to next free array of the class
+		return arr;
+	}
+	u32 size = ((u32)cap * sizeof(u32) + 7) & ~7;
+	if (pnt + size > DB_LIST_CHUNK_SIZE)
+	{
+		if (used == chunks.size())
+		{
+			u8* chunk = (u8*)malloc(DB_LIST_CHUNK_SIZE);
+			if (!chunk)
+				return NULL;
+			chunks.push_back(chunk);
+		}
+		used++;
+		pnt = 0;
+	}
+	arr = (u32*)(chunks[used - 1] + pnt);
+	pnt += size;
+	return arr;
+}
+
+void ListArena::Free(u32* arr, u16 cap)
+{
+	int cls = cap_class[cap];
+	memcpy(arr, &free_arrays[cls], sizeof(u32*));
+	free_arrays[cls] = arr;
+}
+
 TFastBase::TFastBase()
 {
+	for (int i = 0; i < 256; i++)
+		mps[i].SetAlloc(&palloc, i);
 	memset(lists, 0, sizeof(lists));
+	memset(dirty, 0, sizeof(dirty));
 	memset(Header, 0, sizeof(Header));
+	ResetStats();
 }
 
 TFastBase::~TFastBase()
@@ -123,29 +426,237 @@ TFastBase::~TFastBase()
 
 void TFastBase::Clear()
 {
+	Reset();
 	for (int i = 0; i < 256; i++)
+		mps[i].Clear();
+	arena.Clear();
+	palloc.Clear();
+}
+
+//removes all records but keeps pool pages and list arrays mapped for the next solve.
+//Only used blocks of the prefix table are cleared, so it's O(used memory) instead of O(2^24 lists)
+void TFastBase::Reset()
+{
+	for (int i = 0; i < (int)(sizeof(dirty) / sizeof(u64)); i++)
+		while (dirty[i])
+		{
+			u32 bit;
+			_BitScanForward64(&bit, dirty[i]);
+			dirty[i] &= dirty[i] - 1;
+			u32 block = i * 64 + bit;
+			memset(&lists[0][0][0] + block * DB_DIRTY_BLOCK, 0, DB_DIRTY_BLOCK * sizeof(TListRec));
+		}
+	for (int i = 0; i < 256; i++)
+		mps[i].Reset();
+	arena.Reset();
+	ResetStats();
+}
+
+//removes records whose type byte value is marked in remove[256], for example wild DPs of solved point. Visits only used blocks of prefix table.
+//Pools are compacted so memory of removed records is reused, returns number of removed records
+u64 TFastBase::RemoveTypes(bool* remove)
+{
+	u64 removed = 0;
+	for (int i = 0; i < (int)(sizeof(dirty) / sizeof(u64)); i++)
 	{
-		for (int j = 0; j < 256; j++)
-			for (int k = 0; k < 256; k++)
+		u64 msk = dirty[i];
+		while (msk)
+		{
+			u32 bit;
+			_BitScanForward64(&bit, msk);
+			msk &= msk - 1;
+			u32 block = i * 64 + bit;
+			TListRec* list = &lists[0][0][0] + block * DB_DIRTY_BLOCK;
+			int mps_ind = block * DB_DIRTY_BLOCK >> 16;
+			for (int k = 0; k < DB_DIRTY_BLOCK; k++, list++)
 			{
-				if (lists[i][j][k].data)
-					free(lists[i][j][k].data);
-				lists[i][j][k].data = NULL;
-				lists[i][j][k].capacity = 0;
-				lists[i][j][k].cnt = 0;
+				u32 cnt = 0;
+				for (u32 m = 0; m < list->cnt; m++)
+				{
+					u8 type = ((u8*)mps[mps_ind].GetRecPtr(list->data[m]))[DB_REC_LEN - 1];
+					if (remove[type])
+						type_cnt[type % DB_TYPE_CNT]--;
+					else
+						list->data[cnt++] = list->data[m];
+				}
+				if (cnt == list->cnt)
+					continue;
+				UpdateDepthHist(list->cnt, cnt);
+				removed += list->cnt - cnt;
+				list->cnt = cnt;
 			}
-		mps[i].Clear();
+		}
 	}
+	rec_cnt -= removed;
+	if (removed)
+		for (int i = 0; i < 256; i++)
+			CompactPool(i);
+	return removed;
+}
+
+//removes records that have some bits of mask set in x bytes 8...11 (u32), used to raise DP value of the DB:
+//if all DPs also need zero bits in this part of X, DB keeps only records that are DPs for the new value.
+//Pools are compacted so memory of removed records is released, returns number of removed records
+u64 TFastBase::RemoveByMask(u32 mask)
+{
+	u64 removed = 0;
+	for (int i = 0; i < (int)(sizeof(dirty) / sizeof(u64)); i++)
+	{
+		u64 msk = dirty[i];
+		while (msk)
+		{
+			u32 bit;
+			_BitScanForward64(&bit, msk);
+			msk &= msk - 1;
+			u32 block = i * 64 + bit;
+			TListRec* list = &lists[0][0][0] + block * DB_DIRTY_BLOCK;
+			int mps_ind = block * DB_DIRTY_BLOCK >> 16;
+			for (int k = 0; k < DB_DIRTY_BLOCK; k++, list++)
+			{
+				u32 cnt = 0;
+				for (u32 m = 0; m < list->cnt; m++)
+				{
+					u8* rec = (u8*)mps[mps_ind].GetRecPtr(list->data[m]);
+					if (*(u32*)(rec + 8 - DB_KEY_LEN) & mask)
+						type_cnt[rec[DB_REC_LEN - 1] % DB_TYPE_CNT]--;
+					else
+						list->data[cnt++] = list->data[m];
+				}
+				if (cnt == list->cnt)
+					continue;
+				UpdateDepthHist(list->cnt, cnt);
+				removed += list->cnt - cnt;
+				list->cnt = cnt;
+			}
+		}
+	}
+	rec_cnt -= removed;
+	if (removed)
+		for (int i = 0; i < 256; i++)
+			CompactPool(i);
+	return removed;
+}
+
+//moves records of the pool to the beginning keeping their order, so every record moves down or stays.
+//New position of the record is the number of live records before it, lists get new positions and pool is trimmed
+void TFastBase::CompactPool(int mps_ind)
+{
+	u32 slot_cnt = mps[mps_ind].GetPageCnt() * RECS_IN_PAGE;
+	if (!slot_cnt)
+		return;
+	u32 word_cnt = (slot_cnt + 63) / 64;
+	u64* live = (u64*)calloc(word_cnt, sizeof(u64));
+	u32* rank = (u32*)malloc(word_cnt * sizeof(u32));
+	TListRec* first = &lists[mps_ind][0][0];
+	u32 first_block = mps_ind * (256 * 256 / DB_DIRTY_BLOCK);
+	for (u32 b = 0; b < 256 * 256 / DB_DIRTY_BLOCK; b++)
+	{
+		u32 block = first_block + b;
+		if (!((dirty[block / 64] >> (block % 64)) & 1))
+			continue;
+		TListRec* list = first + b * DB_DIRTY_BLOCK;
+		for (int k = 0; k < DB_DIRTY_BLOCK; k++, list++)
+			for (u32 m = 0; m < list->cnt; m++)
+				live[list->data[m] / 64] |= 1ull << (list->data[m] % 64);
+	}
+	u32 live_cnt = 0;
+	for (u32 w = 0; w < word_cnt; w++)
+	{
+		rank[w] = live_cnt;
+		u64 msk = live[w];
+		while (msk)
+		{
+			u32 bit;
+			_BitScanForward64(&bit, msk);
+			msk &= msk - 1;
+			u32 src = w * 64 + bit;
+			if (src != live_cnt)
+				memcpy(mps[mps_ind].GetRecPtr(live_cnt), mps[mps_ind].GetRecPtr(src), DB_REC_LEN);
+			live_cnt++;
+		}
+	}
+	for (u32 b = 0; b < 256 * 256 / DB_DIRTY_BLOCK; b++)
+	{
+		u32 block = first_block + b;
+		if (!((dirty[block / 64] >> (block % 64)) & 1))
+			continue;
+		TListRec* list = first + b * DB_DIRTY_BLOCK;
+		for (int k = 0; k < DB_DIRTY_BLOCK; k++, list++)
+			for (u32 m = 0; m < list->cnt; m++)
+			{
+				u32 ind = list->data[m];
+				list->data[m] = rank[ind / 64] + (u32)__popcnt64(live[ind / 64] & ((1ull << (ind % 64)) - 1));
+			}
+	}
+	free(live);
+	free(rank);
+	mps[mps_ind].Trim(live_cnt);
+}
+
+//DB must be empty. Pool pages of first key byte N go to NUMA node (N % node_cnt) in bind mode, 
+//3byte-prefix table gets transparent huge pages and interleave policy, list arrays stay in malloc
+bool TFastBase::SetAllocMode(int huge_mode, int numa_mode)
+{
+	Clear();
+	if (!palloc.Init(huge_mode, numa_mode))
+		return false;
+	if (!palloc.IsEnabled())
+		return true;
+	//prefix table is already allocated so align the range inside it
+	u64 beg = ((u64)lists + 4095) & ~4095ull;
+	u64 end = ((u64)lists + sizeof(lists)) & ~4095ull;
+	PageAlloc::PlaceMemory((void*)beg, end - beg, huge_mode != DB_HUGE_NONE, (numa_mode == DB_NUMA_NONE) ? DB_NUMA_NONE : DB_NUMA_INTERLEAVE, 0);
+	printf("DB allocation: %s pages, NUMA %s, %d node(s)\r\n", (huge_mode == DB_HUGE_1GB) ? "1GB" : ((huge_mode == DB_HUGE_2MB) ? "2MB" : ((huge_mode == DB_HUGE_THP) ? "transparent huge" : "normal")),
+		(numa_mode == DB_NUMA_BIND) ? "bind" : ((numa_mode == DB_NUMA_INTERLEAVE) ? "interleave" : "off"), palloc.GetNodeCnt());
+	return true;
+}
+
+//counters are updated on every insert so we never have to scan all lists to get stats
+void TFastBase::ResetStats()
+{
+	rec_cnt = 0;
+	list_bytes = 0;
+	memset(type_cnt, 0, sizeof(type_cnt));
+	memset(depth_hist, 0, sizeof(depth_hist));
+	depth_hist[0] = 256 * 256 * 256;
+}
+
+static inline int DepthHistInd(u32 cnt)
+{
+	if (!cnt)
+		return 0;
+	u32 ind;
+	_BitScanReverse64(&ind, cnt);
+	return ind + 1;
+}
+
+void TFastBase::UpdateDepthHist(u32 old_cnt, u32 new_cnt)
+{
+	depth_hist[DepthHistInd(old_cnt)]--;
+	depth_hist[DepthHistInd(new_cnt)]++;
 }
 
 u64 TFastBase::GetBlockCnt()
 {
-	u64 blockCount = 0;
+	return rec_cnt;
+}
+
+void TFastBase::GetStats(TDbStats* stats)
+{
+	stats->RecCnt = rec_cnt;
+	memcpy(stats->TypeCnt, type_cnt, sizeof(type_cnt));
+	memcpy(stats->DepthHist, depth_hist, sizeof(depth_hist));
+	stats->PageCnt = 0;
 	for (int i = 0; i < 256; i++)
-		for (int j = 0; j < 256; j++)
-			for (int k = 0; k < 256; k++)
-			blockCount += lists[i][j][k].cnt;
-	return blockCount;
+		stats->PageCnt += mps[i].GetPageCnt();
+	stats->PoolBytes = stats->PageCnt * MEM_PAGE_SIZE;
+	stats->ListBytes = list_bytes;
+	stats->IndexBytes = sizeof(lists);
+	u64 reserved_pages = 0;
+	for (int i = 0; i < 256; i++)
+		reserved_pages += mps[i].GetReservedCnt();
+	stats->ReservedBytes = reserved_pages * MEM_PAGE_SIZE + (arena.GetMemSize() - list_bytes);
+	stats->TotalBytes = stats->PoolBytes + stats->ListBytes + stats->IndexBytes + stats->ReservedBytes;
 }
 
 // http://en.cppreference.com/w/cpp/algorithm/lower_bound
@@ -176,15 +687,21 @@ u8* TFastBase::AddDataBlock(u8* data, int pos)
 	TListRec* list = &lists[data[0]][data[1]][data[2]];
 	if (list->cnt >= list->capacity)
 	{
-		u32 grow = list->capacity / 2;
-		if (grow < DB_MIN_GROW_CNT)
-			grow = DB_MIN_GROW_CNT;
-		u32 newcap = list->capacity + grow;
-		if (newcap > 0xFFFF)
-			newcap = 0xFFFF;
+		u16 newcap = arena.GetNextCap(list->capacity);
 		if (newcap <= list->capacity)
 			return NULL; //failed
-		list->data = (u32*)realloc(list->data, newcap * sizeof(u32));
+		u32* arr = arena.Alloc(newcap);
+		if (!arr)
+			return NULL;
+		if (list->data)
+		{
+			memcpy(arr, list->data, list->cnt * sizeof(u32));
+			arena.Free(list->data, list->capacity);
+		}
+		else
+			SetDirty((data[0] << 16) | (data[1] << 8) | data[2]);
+		list->data = arr;
+		list_bytes += (newcap - list->capacity) * sizeof(u32);
 		list->capacity = newcap;
 	}
 	int first = (pos < 0) ? lower_bound(list, data[0], data + 3) : pos;
@@ -194,6 +711,9 @@ u8* TFastBase::AddDataBlock(u8* data, int pos)
 	list->data[first] = cmp_ptr;
 	memcpy(ptr, data + 3, DB_REC_LEN);
 	list->cnt++;
+	UpdateDepthHist(list->cnt - 1, list->cnt);
+	rec_cnt++;
+	type_cnt[data[DB_FULL_REC_LEN - 1] % DB_TYPE_CNT]++;
 	return (u8*)ptr;
 }
 
@@ -226,80 +746,491 @@ label_not_found:
 	return NULL;
 }
 
+//sorts batch by 3-byte prefix (stable LSD radix sort), returns indices of records in sorted order
+u32* TFastBase::SortBatch(u8* data, int cnt)
+{
+	batch_ind.resize(cnt);
+	batch_tmp.resize(cnt);
+	u32* src = batch_ind.data();
+	u32* dst = batch_tmp.data();
+	for (int i = 0; i < cnt; i++)
+		src[i] = i;
+	for (int b = DB_KEY_LEN - 1; b >= 0; b--)
+	{
+		u32 offs[256];
+		memset(offs, 0, sizeof(offs));
+		for (int i = 0; i < cnt; i++)
+			offs[data[src[i] * DB_FULL_REC_LEN + b]]++;
+		u32 sum = 0;
+		for (int i = 0; i < 256; i++)
+		{
+			u32 t = offs[i];
+			offs[i] = sum;
+			sum += t;
+		}
+		for (int i = 0; i < cnt; i++)
+		{
+			u32 ind = src[i];
+			dst[offs[data[ind * DB_FULL_REC_LEN + b]]++] = ind;
+		}
+		u32* t = src;
+		src = dst;
+		dst = t;
+	}
+	return src;
+}
+
+//data is array of cnt records, DB_FULL_REC_LEN bytes each
+//records are processed in prefix order so we visit lists and pool pages sequentially, and we prefetch them in three stages:
+//list header, then its index array, then the record that lower_bound checks first
+//returns number of processed records, it's less than cnt if callback stopped processing
+int TFastBase::FindOrAddBatch(u8* data, int cnt, TFindCallback callback, void* ctx)
+{
+	if (cnt <= 0)
+		return 0;
+	u32* order = SortBatch(data, cnt);
+	for (int i = 0; i < cnt; i++)
+	{
+		if (i + 3 * DB_PREFETCH_DIST < cnt)
+		{
+			u8* pf = data + order[i + 3 * DB_PREFETCH_DIST] * DB_FULL_REC_LEN;
+			_mm_prefetch((const char*)&lists[pf[0]][pf[1]][pf[2]], _MM_HINT_T0);
+		}
+		if (i + 2 * DB_PREFETCH_DIST < cnt)
+		{
+			u8* pf = data + order[i + 2 * DB_PREFETCH_DIST] * DB_FULL_REC_LEN;
+			TListRec* list = &lists[pf[0]][pf[1]][pf[2]];
+			if (list->cnt)
+				_mm_prefetch((const char*)(list->data + list->cnt / 2), _MM_HINT_T0);
+		}
+		if (i + DB_PREFETCH_DIST < cnt)
+		{
+			u8* pf = data + order[i + DB_PREFETCH_DIST] * DB_FULL_REC_LEN;
+			TListRec* list = &lists[pf[0]][pf[1]][pf[2]];
+			if (list->cnt)
+				_mm_prefetch((const char*)mps[pf[0]].GetRecPtr(list->data[list->cnt / 2]), _MM_HINT_T0);
+		}
+		u8* rec = data + order[i] * DB_FULL_REC_LEN;
+		u8* found = FindOrAddDataBlock(rec);
+		if (found && callback && !callback(rec, found, ctx))
+			return i + 1;
+	}
+	return cnt;
+}
+
 //slow but I hope you are not going to create huge DB with this proof-of-concept software
-bool TFastBase::LoadFromFile(char* fn)
+//reads DB from current position of the file, fp stays open
+//ext_mask (if not zero) skips records that have any of these bits set in x[1] (bytes 8..11 of full record)
+bool TFastBase::LoadFromStream(FILE* fp, u32 ext_mask)
 {
-	Clear();
+	Reset();
+	if (fread(Header, 1, sizeof(Header), fp) != sizeof(Header))
+		return false;
+	u8* buf = (u8*)malloc(0xFFFF * DB_REC_LEN);
+	bool res = true;
+	for (int i = 0; res && (i < 256); i++)
+		for (int j = 0; res && (j < 256); j++)
+			for (int k = 0; k < 256; k++)
+			{
+				TListRec* list = &lists[i][j][k];
+				u16 file_cnt;
+				if (fread(&file_cnt, 1, 2, fp) != 2)
+				{
+					res = false;
+					break;
+				}
+				if (!file_cnt)
+					continue;
+				if (fread(buf, DB_REC_LEN, file_cnt, fp) != file_cnt)
+				{
+					res = false;
+					break;
+				}
+				u16 cnt = file_cnt;
+				if (ext_mask)
+				{
+					cnt = 0;
+					for (int m = 0; m < file_cnt; m++)
+						if (!(*(u32*)(buf + m * DB_REC_LEN + 8 - DB_KEY_LEN) & ext_mask))
+							memmove(buf + (cnt++) * DB_REC_LEN, buf + m * DB_REC_LEN, DB_REC_LEN);
+					if (!cnt)
+						continue;
+				}
+				u16 newcap = arena.GetNextCap(0);
+				while (newcap <= cnt && newcap < 0xFFFF)
+					newcap = arena.GetNextCap(newcap);
+				list->data = arena.Alloc(newcap);
+				if (!list->data)
+				{
+					res = false;
+					break;
+				}
+				list->cnt = cnt;
+				SetDirty((i << 16) | (j << 8) | k);
+				list_bytes += newcap * sizeof(u32);
+				list->capacity = newcap;
+				UpdateDepthHist(0, list->cnt);
+
+				for (int m = 0; m < cnt; m++)
+				{
+					u32 cmp_ptr;
+					void* ptr = mps[i].AllocRec(&cmp_ptr);
+					list->data[m] = cmp_ptr;
+					memcpy(ptr, buf + m * DB_REC_LEN, DB_REC_LEN);
+					rec_cnt++;
+					type_cnt[((u8*)ptr)[DB_REC_LEN - 1] % DB_TYPE_CNT]++;
+				}
+			}
+	free(buf);
+	return res;
+}
+
+bool TFastBase::LoadFromFile(char* fn, u32 ext_mask)
+{
+	Reset();
 	FILE* fp = fopen(fn, "rb");
 	if (!fp)
 		return false;
-	if (fread(Header, 1, sizeof(Header), fp) != sizeof(Header))
-	{
-		fclose(fp);
+	bool res = LoadFromStream(fp, ext_mask);
+	fclose(fp);
+	return res;
+}
+
+//writes DB to current position of the file, fp stays open
+//types (if not NULL) selects records to save by type byte value
+bool TFastBase::SaveToStream(FILE* fp, bool* types)
+{
+	if (fwrite(Header, 1, sizeof(Header), fp) != sizeof(Header))
 		return false;
-	}
 	for (int i = 0; i < 256; i++)
 		for (int j = 0; j < 256; j++)
 			for (int k = 0; k < 256; k++)
 			{
 				TListRec* list = &lists[i][j][k];
-				fread(&list->cnt, 1, 2, fp);
-				if (list->cnt)
+				u16 cnt = list->cnt;
+				if (types)
 				{
-					u32 grow = list->cnt / 2;
-					if (grow < DB_MIN_GROW_CNT)
-						grow = DB_MIN_GROW_CNT;
-					u32 newcap = list->cnt + grow;
-					if (newcap > 0xFFFF)
-						newcap = 0xFFFF;
-					list->data = (u32*)realloc(list->data, newcap * sizeof(u32));
-					list->capacity = newcap;
-
+					cnt = 0;
 					for (int m = 0; m < list->cnt; m++)
-					{
-						u32 cmp_ptr;
-						void* ptr = mps[i].AllocRec(&cmp_ptr);
-						list->data[m] = cmp_ptr;
-						if (fread(ptr, 1, DB_REC_LEN, fp) != DB_REC_LEN)
-						{
-							fclose(fp);
-							return false;
-						}
-					}
+						cnt += types[((u8*)mps[i].GetRecPtr(list->data[m]))[DB_REC_LEN - 1]];
+				}
+				fwrite(&cnt, 1, 2, fp);
+				for (int m = 0; m < list->cnt; m++)
+				{
+					u8* ptr = (u8*)mps[i].GetRecPtr(list->data[m]);
+					if (types && !types[ptr[DB_REC_LEN - 1]])
+						continue;
+					if (fwrite(ptr, 1, DB_REC_LEN, fp) != DB_REC_LEN)
+						return false;
 				}
 			}
-	fclose(fp);
 	return true;
 }
 
-bool TFastBase::SaveToFile(char* fn)
+bool TFastBase::SaveToFile(char* fn, bool* types)
 {
 	FILE* fp = fopen(fn, "wb");
 	if (!fp)
 		return false;
-	if (fwrite(Header, 1, sizeof(Header), fp) != sizeof(Header))
+	bool res = SaveToStream(fp, types);
+	if (fclose(fp))
+		res = false;
+	return res;
+}
+
+static u32 JournalChecksum(u8* data, u64 size)
+{
+	u32 hash = 0x811C9DC5; //FNV-1a
+	for (u64 i = 0; i < size; i++)
+		hash = (hash ^ data[i]) * 0x01000193;
+	return hash;
+}
+
+#ifdef _WIN32
+u32 __stdcall journal_thr_proc(void* data)
+#else
+void* journal_thr_proc(void* data)
+#endif
+{
+	((DPJournal*)data)->ThreadProc();
+	return 0;
+}
+
+DPJournal::DPJournal()
+{
+	fp = NULL;
+	len = 0;
+	sync_len = 0;
+	sync_ms = 0;
+	last_sync = 0;
+	stop = false;
+	thr_started = false;
+}
+
+DPJournal::~DPJournal()
+{
+	Close();
+}
+
+//header must match when journal is replayed
+bool DPJournal::Create(char* fn, u8* header, u64 _sync_ms)
+{
+	Close();
+	fp = fopen(fn, "wb");
+	if (!fp)
+		return false;
+	if (fwrite(header, 1, JOURNAL_HEADER_SIZE, fp) != JOURNAL_HEADER_SIZE)
 	{
 		fclose(fp);
+		fp = NULL;
 		return false;
 	}
-	for (int i = 0; i < 256; i++)
-		for (int j = 0; j < 256; j++)
-			for (int k = 0; k < 256; k++)
+	sync_ms = _sync_ms;
+	return Open(JOURNAL_HEADER_SIZE);
+}
+
+//continues existing journal, header must match. Data after valid_len (returned by Replay) is dropped
+bool DPJournal::Append(char* fn, u8* header, u64 valid_len, u64 _sync_ms)
+{
+	Close();
+	if (valid_len < JOURNAL_HEADER_SIZE)
+		return false;
+	fp = fopen(fn, "r+b");
+	if (!fp)
+		return false;
+	u8 hdr[JOURNAL_HEADER_SIZE];
+	if ((fread(hdr, 1, JOURNAL_HEADER_SIZE, fp) != JOURNAL_HEADER_SIZE) || memcmp(hdr, header, JOURNAL_HEADER_SIZE))
+	{
+		fclose(fp);
+		fp = NULL;
+		return false;
+	}
+	sync_ms = _sync_ms;
+	return Open(valid_len);
+}
+
+//file position is set to valid_len and everything after it is dropped
+bool DPJournal::Truncate(u64 valid_len)
+{
+	fflush(fp);
+	clearerr(fp);
+#ifdef _WIN32
+	return !_fseeki64(fp, valid_len, SEEK_SET) && !_chsize_s(_fileno(fp), valid_len);
+#else
+	return !fseeko(fp, valid_len, SEEK_SET) && !ftruncate(fileno(fp), valid_len);
+#endif
+}
+
+bool DPJournal::Open(u64 valid_len)
+{
+	if (!Truncate(valid_len))
+	{
+		fclose(fp);
+		fp = NULL;
+		return false;
+	}
+	len = valid_len;
+	sync_len = valid_len;
+	last_sync = GetTickCount64();
+	stop = false;
+#ifdef _WIN32
+	thr = (HANDLE)_beginthreadex(NULL, 0, journal_thr_proc, this, 0, NULL);
+#else
+	pthread_create(&thr, NULL, journal_thr_proc, this);
+#endif
+	thr_started = true;
+	return true;
+}
+
+//called by ingestion thread, only copies records to memory
+void DPJournal::Add(u8* recs, int cnt)
+{
+	if (!fp || !cnt)
+		return;
+	cs.Enter();
+	buf.insert(buf.end(), recs, recs + (u64)cnt * DB_FULL_REC_LEN);
+	cs.Leave();
+}
+
+bool DPJournal::WriteBuffer(bool sync)
+{
+	cs_write.Enter();
+	cs.Enter();
+	wbuf.swap(buf);
+	cs.Leave();
+	bool res = true;
+	if (!wbuf.empty())
+	{
+		u32 hdr[2];
+		hdr[0] = (u32)(wbuf.size() / DB_FULL_REC_LEN);
+		hdr[1] = JournalChecksum(wbuf.data(), wbuf.size());
+		res = (fwrite(hdr, 1, 8, fp) == 8) && (fwrite(wbuf.data(), 1, wbuf.size(), fp) == wbuf.size());
+		if (res)
+			len += 8 + wbuf.size();
+		else
+		{
+			//partial batch would break replay of batches written after it
+			printf("DP journal write failed, %llu records are not saved, journal is truncated to %llu bytes\r\n", (u64)(wbuf.size() / DB_FULL_REC_LEN), len);
+			if (!Truncate(len))
+				printf("DP journal truncation failed\r\n");
+		}
+		wbuf.clear();
+	}
+	if (sync || (GetTickCount64() - last_sync >= sync_ms))
+	{
+#ifdef _WIN32
+		bool ok = !fflush(fp) && !_commit(_fileno(fp));
+#else
+		bool ok = !fflush(fp) && !fsync(fileno(fp));
+#endif
+		if (ok)
+			sync_len = len;
+		else
+		{
+			//data after last sync can be lost, so it must not be reported as safe by Flush
+			printf("DP journal sync failed, %llu bytes are dropped, journal is truncated to %llu bytes\r\n", len - sync_len, sync_len);
+			if (!Truncate(sync_len))
+				printf("DP journal truncation failed\r\n");
+			len = sync_len;
+			res = false;
+		}
+		last_sync = GetTickCount64();
+	}
+	cs_write.Leave();
+	return res;
+}
+
+void DPJournal::ThreadProc()
+{
+	while (!stop)
+	{
+		Sleep(JOURNAL_WRITE_MS);
+		if (!WriteBuffer(false))
+			printf("WARNING: cannot write DP journal!\r\n");
+	}
+}
+
+//writes all added records to disk, returns journal length that is safe now
+u64 DPJournal::Flush()
+{
+	if (!fp)
+		return 0;
+	WriteBuffer(true);
+	return len;
+}
+
+void DPJournal::Close()
+{
+	if (!fp)
+		return;
+	stop = true;
+	if (thr_started)
+	{
+#ifdef _WIN32
+		WaitForSingleObject(thr, INFINITE);
+		CloseHandle(thr);
+#else
+		pthread_join(thr, NULL);
+#endif
+		thr_started = false;
+	}
+	WriteBuffer(true);
+	fclose(fp);
+	fp = NULL;
+	buf.clear();
+}
+
+//adds all complete batches to DB, records that are already in DB are passed to callback, valid_len receives the length of journal without broken tail
+bool DPJournal::Replay(char* fn, u8* header, TFastBase* db, TFindCallback callback, void* ctx, u64* valid_len, u64* rec_cnt)
+{
+	*valid_len = 0;
+	*rec_cnt = 0;
+	FILE* f = fopen(fn, "rb");
+	if (!f)
+		return false;
+	u8 hdr[JOURNAL_HEADER_SIZE];
+	if ((fread(hdr, 1, JOURNAL_HEADER_SIZE, f) != JOURNAL_HEADER_SIZE) || memcmp(hdr, header, JOURNAL_HEADER_SIZE))
+	{
+		fclose(f);
+		return false;
+	}
+#ifdef _WIN32
+	_fseeki64(f, 0, SEEK_END);
+	u64 file_len = _ftelli64(f);
+	_fseeki64(f, JOURNAL_HEADER_SIZE, SEEK_SET);
+#else
+	fseeko(f, 0, SEEK_END);
+	u64 file_len = ftello(f);
+	fseeko(f, JOURNAL_HEADER_SIZE, SEEK_SET);
+#endif
+	u64 pos = JOURNAL_HEADER_SIZE;
+	std::vector <u8> data;
+	while (1)
+	{
+		u32 bhdr[2];
+		if ((fread(bhdr, 1, 8, f) != 8) || (pos + 8 + (u64)bhdr[0] * DB_FULL_REC_LEN > file_len))
+			break;
+		data.resize((u64)bhdr[0] * DB_FULL_REC_LEN);
+		if ((fread(data.data(), 1, data.size(), f) != data.size()) || (JournalChecksum(data.data(), data.size()) != bhdr[1]))
+			break;
+		for (u32 i = 0; i < bhdr[0]; i += 64 * 1024)
+			db->FindOrAddBatch(data.data() + (u64)i * DB_FULL_REC_LEN, (int)((bhdr[0] - i < 64 * 1024) ? (bhdr[0] - i) : 64 * 1024), callback, ctx);
+		*rec_cnt += bhdr[0];
+		pos += 8 + data.size();
+	}
+	fclose(f);
+	*valid_len = pos;
+	return true;
+}
+
+//adds records from file to DB, records that are already in DB are passed to callback. header receives file header, DB header is not changed
+bool TFastBase::MergeFromFile(char* fn, u8* header, TFindCallback callback, void* ctx)
+{
+	FILE* fp = fopen(fn, "rb");
+	if (!fp)
+		return false;
+	if (fread(header, 1, sizeof(Header), fp) != sizeof(Header))
+	{
+		fclose(fp);
+		return false;
+	}
+	const int batch_cnt = 64 * 1024;
+	u8* batch = (u8*)malloc(batch_cnt * DB_FULL_REC_LEN);
+	int cnt = 0;
+	bool res = true;
+	for (int i = 0; res && (i < 256); i++)
+		for (int j = 0; res && (j < 256); j++)
+			for (int k = 0; res && (k < 256); k++)
 			{
-				TListRec* list = &lists[i][j][k];
-				fwrite(&list->cnt, 1, 2, fp);
-				for (int m = 0; m < list->cnt; m++)
+				u16 list_cnt;
+				if (fread(&list_cnt, 1, 2, fp) != 2)
 				{
-					void* ptr = mps[i].GetRecPtr(list->data[m]);
-					if (fwrite(ptr, 1, DB_REC_LEN, fp) != DB_REC_LEN)
+					res = false;
+					break;
+				}
+				for (int m = 0; m < list_cnt; m++)
+				{
+					u8* rec = batch + cnt * DB_FULL_REC_LEN;
+					rec[0] = i;
+					rec[1] = j;
+					rec[2] = k;
+					if (fread(rec + DB_KEY_LEN, 1, DB_REC_LEN, fp) != DB_REC_LEN)
 					{
-						fclose(fp);
-						return false;
+						res = false;
+						break;
+					}
+					if (++cnt == batch_cnt)
+					{
+						FindOrAddBatch(batch, cnt, callback, ctx);
+						cnt = 0;
 					}
 				}
 			}
+	if (res && cnt)
+		FindOrAddBatch(batch, cnt, callback, ctx);
+	free(batch);
 	fclose(fp);
-	return true;
+	return res;
 }
 
 bool IsFileExist(char* fn)
@@ -309,4 +1240,21 @@ bool IsFileExist(char* fn)
 		return false;
 	fclose(fp);
 	return true;
+}
+
+//returns 0 if file not found
+u64 GetFileLen(char* fn)
+{
+	FILE* fp = fopen(fn, "rb");
+	if (!fp)
+		return 0;
+#ifdef _WIN32
+	_fseeki64(fp, 0, SEEK_END);
+	u64 len = _ftelli64(fp);
+#else
+	fseeko(fp, 0, SEEK_END);
+	u64 len = ftello(fp);
+#endif
+	fclose(fp);
+	return len;
 }
\ No newline at end of file
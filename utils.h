@@ -43,6 +43,7 @@
 	static void Sleep(int x) { usleep(x * 1000); }      
     void _BitScanReverse64(u32* index, u64 msk);
     void _BitScanForward64(u32* index, u64 msk);       
+    u64 __popcnt64(u64 msk);
     typedef __uint128_t uint128_t;
     u64 _umul128(u64 m1, u64 m2, u64* hi);
     u64 __shiftright128 (u64 LowPart, u64 HighPart, u8 Shift);
@@ -61,6 +62,30 @@ public:
 	void Leave() { UNLOCK_CS(&cs_body); };
 };
 
+#define DB_REC_LEN			32
+#define DB_KEY_LEN			3	//first bytes of the record are used as index in lists and not stored
+#define DB_FULL_REC_LEN		(DB_KEY_LEN + DB_REC_LEN)
+#define DB_FIND_LEN			9	//records in lists are sorted by these bytes after the key
+
+#define DB_TYPE_CNT			4	//last byte of the record is kang type
+#define DB_DEPTH_HIST_CNT	17	//lists by number of records: 0, 1, 2-3, 4-7, ..., 32768-65535
+
+struct TDbStats
+{
+	u64 RecCnt;
+	u64 TypeCnt[DB_TYPE_CNT];
+	u64 PageCnt; //allocated pool pages
+	u64 PoolBytes; //memory of pool pages
+	u64 ListBytes; //memory of list index arrays
+	u64 IndexBytes; //3byte-prefix table
+	u64 ReservedBytes; //pages and list arrays kept after Reset for reuse
+	u64 TotalBytes;
+	u64 DepthHist[DB_DEPTH_HIST_CNT];
+};
+
+//called by FindOrAddBatch for every record that is already in DB, return false to stop processing of the batch
+typedef bool (*TFindCallback)(u8* data, u8* found, void* ctx);
+
 #pragma pack(push, 1)
 struct TListRec
 {
@@ -68,39 +93,205 @@ struct TListRec
 	u16 capacity;
 	u32* data;
 };
+
+//header of tames and wilds files (DB Header, 256 bytes), DB follows. Old tames files have range only
+struct TDbFileHeader
+{
+	u8 range;
+	u8 dp; //DP bits of x[3] checked by GPUs
+	u8 dp_ext_bits; //low bits of x[1] that are zero too, see gDPExtMask
+	u8 kind; //DB_FILE_TAMES or DB_FILE_WILDS
+	u32 version;
+	u64 total_ops; //ops of all runs that made the file
+	u8 pnt[64]; //wilds: point to solve, x and y
+	char sign[8];
+	u64 jump_seed;
+	u64 jump_hash; //hash of all jump distances, DPs are valid only with the same jumps
+	u32 jmp_cnt;
+	u16 key_len;
+	u16 rec_len;
+	u8 x_len;
+	u8 d_len;
+	u16 gpu_cnt; //GPUs and kangaroos of the last run, for information
+	u32 kang_cnt;
+	u64 rec_cnt;
+	u8 reserved[128];
+};
+
+struct DBRec
+{
+	u8 x[12];
+	u8 d[22];
+	u8 type; //0 - tame, 1 - wild1, 2 - wild2, high bits - target index (see KANG_TYPE_MASK)
+};
 #pragma pack(pop)
 
+#define DB_HUGE_NONE		0
+#define DB_HUGE_THP			1	//transparent huge pages (madvise)
+#define DB_HUGE_2MB			2	//MAP_HUGETLB, pages must be reserved in /proc/sys/vm/nr_hugepages
+#define DB_HUGE_1GB			3	//MAP_HUGETLB | MAP_HUGE_1GB
+
+#define DB_NUMA_NONE		0
+#define DB_NUMA_INTERLEAVE	1	//pages are interleaved over all nodes
+#define DB_NUMA_BIND		2	//pool of first key byte N is bound to node (N % node_cnt)
+
+#define DB_MAX_NUMA_NODES	64
+
+//allocates MemPool pages from large chunks which can be backed by huge pages and placed on NUMA nodes
+class PageAlloc
+{
+private:
+	struct TChunk
+	{
+		void* ptr;
+		u64 size;
+	};
+	std::vector <TChunk> chunks;
+	u8* cur[DB_MAX_NUMA_NODES];
+	u64 cur_left[DB_MAX_NUMA_NODES];
+	int huge_mode;
+	int numa_mode;
+	int node_cnt;
+	u64 chunk_size;
+	u8* AllocChunk(int node);
+public:
+	PageAlloc();
+	~PageAlloc();
+	bool Init(int _huge_mode, int _numa_mode);
+	bool IsEnabled() { return (huge_mode != DB_HUGE_NONE) || (numa_mode != DB_NUMA_NONE); }
+	int GetNodeCnt() { return node_cnt; }
+	void* AllocPage(int node);
+	void ReleasePage(void* page);
+	void Clear();
+	static bool PlaceMemory(void* ptr, u64 size, bool thp, int numa_mode, u64 node_mask);
+};
+
 class MemPool
 {
 private:
 	std::vector <void*> pages;
+	u32 used; //pages in use, rest of pages are kept after Reset
 	u32 pnt;
+	PageAlloc* palloc;
+	int node;
 public:
 	MemPool();
 	~MemPool();
+	void SetAlloc(PageAlloc* _palloc, int _node) { palloc = _palloc; node = _node; }
 	void Clear();
+	void Reset();
+	u32 GetPageCnt() { return used; }
+	u32 GetReservedCnt() { return (u32)pages.size() - used; }
+	void Trim(u32 rec_cnt);
 	inline void* AllocRec(u32* cmp_ptr);
 	inline void* GetRecPtr(u32 cmp_ptr);
 };
 
+#define DB_LIST_CLASS_CNT	64
+#define DB_LIST_CHUNK_SIZE	(4 * 1024 * 1024)
+#define DB_DIRTY_BLOCK		64	//lists, TFastBase::Reset clears only blocks that were used
+
+//index arrays of lists, allocated by capacity classes from big chunks. Freed arrays go to per-class free lists,
+//Reset drops all arrays at once and keeps chunks for reuse
+class ListArena
+{
+private:
+	std::vector <u8*> chunks;
+	u32 used; //chunks in use
+	u32 pnt;
+	u16 class_cap[DB_LIST_CLASS_CNT];
+	u8 cap_class[0x10000];
+	u32* free_arrays[DB_LIST_CLASS_CNT];
+public:
+	ListArena();
+	~ListArena();
+	void Clear();
+	void Reset();
+	u16 GetNextCap(u16 cap) { return class_cap[cap_class[cap] + 1]; }
+	u32* Alloc(u16 cap);
+	void Free(u32* arr, u16 cap);
+	u64 GetMemSize() { return (u64)chunks.size() * DB_LIST_CHUNK_SIZE; }
+};
+
 class TFastBase
 {
 private:
+	PageAlloc palloc;
 	MemPool mps[256];
+	ListArena arena;
 	TListRec lists[256][256][256];
+	u64 dirty[256 * 256 * 256 / DB_DIRTY_BLOCK / 64]; //bit per block of DB_DIRTY_BLOCK lists that has allocated lists
+	void SetDirty(u32 list_ind) { dirty[list_ind / DB_DIRTY_BLOCK / 64] |= 1ull << ((list_ind / DB_DIRTY_BLOCK) & 63); }
+	u64 rec_cnt;
+	u64 type_cnt[DB_TYPE_CNT];
+	u64 list_bytes;
+	u64 depth_hist[DB_DEPTH_HIST_CNT];
+	std::vector <u32> batch_ind;
+	std::vector <u32> batch_tmp;
 	int lower_bound(TListRec* list, int mps_ind, u8* data);
+	u32* SortBatch(u8* data, int cnt);
+	void ResetStats();
+	void UpdateDepthHist(u32 old_cnt, u32 new_cnt);
+	void CompactPool(int mps_ind);
 public:
 	u8 Header[256];
 
 	TFastBase();
 	~TFastBase();
 	void Clear();
+	void Reset();
+	u64 RemoveTypes(bool* remove);
+	u64 RemoveByMask(u32 mask);
+	bool SetAllocMode(int huge_mode, int numa_mode);
 	u8* AddDataBlock(u8* data, int pos = -1);
 	u8* FindDataBlock(u8* data);
 	u8* FindOrAddDataBlock(u8* data);
+	int FindOrAddBatch(u8* data, int cnt, TFindCallback callback, void* ctx);
 	u64 GetBlockCnt();
-	bool LoadFromFile(char* fn);
-	bool SaveToFile(char* fn);
+	void GetStats(TDbStats* stats);
+	bool LoadFromStream(FILE* fp, u32 ext_mask = 0);
+	bool SaveToStream(FILE* fp, bool* types = NULL);
+	bool LoadFromFile(char* fn, u32 ext_mask = 0);
+	bool SaveToFile(char* fn, bool* types = NULL);
+	bool MergeFromFile(char* fn, u8* header, TFindCallback callback, void* ctx);
+};
+
+#define JOURNAL_HEADER_SIZE	128
+#define JOURNAL_WRITE_MS	100	//writer thread period
+
+//append-only journal of DB records (DB_FULL_REC_LEN bytes each). Records are added to memory buffer,
+//writer thread appends them as batches (u32 cnt, u32 checksum, records) and calls fsync every sync_ms.
+//Incomplete batch at the end (crash during write) is ignored by Replay
+class DPJournal
+{
+private:
+	FILE* fp;
+	CriticalSection cs;
+	CriticalSection cs_write;
+	std::vector <u8> buf;
+	std::vector <u8> wbuf;
+	u64 len; //bytes in file
+	u64 sync_len; //bytes that are on disk after last successful sync
+	u64 sync_ms;
+	u64 last_sync;
+	volatile bool stop;
+	bool thr_started;
+	HHANDLER thr;
+	bool Open(u64 valid_len);
+	bool Truncate(u64 valid_len);
+	bool WriteBuffer(bool sync);
+public:
+	DPJournal();
+	~DPJournal();
+	bool IsOpen() { return fp != NULL; }
+	bool Create(char* fn, u8* header, u64 _sync_ms);
+	bool Append(char* fn, u8* header, u64 valid_len, u64 _sync_ms);
+	static bool Replay(char* fn, u8* header, TFastBase* db, TFindCallback callback, void* ctx, u64* valid_len, u64* rec_cnt);
+	void Add(u8* recs, int cnt);
+	u64 Flush();
+	void Close();
+	void ThreadProc();
 };
 
-bool IsFileExist(char* fn);
\ No newline at end of file
+bool IsFileExist(char* fn);
+u64 GetFileLen(char* fn);
\ No newline at end of file